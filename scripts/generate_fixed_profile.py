@@ -0,0 +1,329 @@
+#!/usr/bin/env python3
+"""Generate compiled teleop_twist_joy mappings from config files.
+
+Usage: generate_fixed_profile.py <config.yaml> <output.hpp>
+       generate_fixed_profile.py --database <profiles.yaml> <output.db>
+
+The first form writes a constexpr CompiledConfig for a fixed profile. The second writes the
+memory-mapped profile database read by src/profile_db.cpp, from a list of config files and the
+Joy shape each one is for.
+
+Parameters missing from a file keep the node's defaults, so the generated table is exactly what
+the node would compile at startup from the same file.
+"""
+
+import math
+import os
+import struct
+import sys
+
+import yaml
+
+FIELDS = ['x', 'y', 'z', 'yaw', 'pitch', 'roll']
+MAX_JOINTS = 16
+STAGES = ['deadband', 'expo', 'lowpass', 'scale', 'limit']
+MAX_STAGES = 8
+MAX_AXES = 16
+MAX_PAIRS = 4
+
+DEFAULTS = {
+    'axis_linear': {'x': 5, 'y': -1, 'z': -1},
+    'axis_angular': {'yaw': 2, 'pitch': -1, 'roll': -1},
+    'axis_angular_adjustment': {'yaw': 3, 'pitch': -1, 'roll': -1},
+    'scale_linear': {'x': 0.5, 'y': 0.0, 'z': 0.0},
+    'scale_linear_turbo': {'x': 1.0, 'y': 0.0, 'z': 0.0},
+    'scale_linear_autorun': {'x': 1.0, 'y': 0.0, 'z': 0.0},
+    'scale_angular': {'yaw': 0.5, 'pitch': 0.0, 'roll': 0.0},
+    'scale_angular_turbo': {'yaw': 1.0, 'pitch': 0.0, 'roll': 0.0},
+    'scale_angular_autorun': {'yaw': 1.0, 'pitch': 0.0, 'roll': 0.0},
+    'require_enable_button': True,
+    'enable_button': 5,
+    'enable_turbo_button': -1,
+    'enable_autorun_button': -1,
+    'joint_jog': {'joint_names': [], 'axes': [], 'scales': [], 'scales_turbo': []},
+    'pipeline': [],
+    'axis_normalization': {'gain': [], 'offset': []},
+    'stick_pairs': [],
+    'stick_radial_deadzone': 0.0,
+    'stick_circle_to_square': False,
+    'stick_snap_angle': 0.0,
+}
+
+
+def load_parameters(path):
+    """Return the node's ros__parameters from a config file, merged over the defaults."""
+    with open(path) as f:
+        document = yaml.safe_load(f) or {}
+    parameters = {}
+    for node in document.values():
+        if isinstance(node, dict) and 'ros__parameters' in node:
+            parameters = node['ros__parameters'] or {}
+            break
+
+    merged = {}
+    for key, default in DEFAULTS.items():
+        value = parameters.get(key, default)
+        if isinstance(default, dict):
+            value = dict(default, **(value or {}))
+        merged[key] = value
+    return merged
+
+
+def parse_pipeline(spec):
+    """Mirror of parsePipeline() in src/pipeline.cpp, returning (type, field_mask, value) tuples.
+
+    The checks are the same, so a profile is rejected here exactly when the node would reject
+    the same pipeline parameter.
+    """
+    if len(spec) > MAX_STAGES:
+        raise ValueError('at most %d pipeline stages are supported' % MAX_STAGES)
+    stages = []
+    for entry in spec:
+        parts = entry.split(':', 2)
+        if len(parts) < 2 or parts[0] not in STAGES:
+            raise ValueError("pipeline stage '%s' is not <deadband|expo|lowpass|scale|limit>:<value>[:<fields>]"
+                             % entry)
+        stage = parts[0]
+        try:
+            value = float(parts[1])
+        except ValueError:
+            value = math.nan
+        if not math.isfinite(value):
+            raise ValueError("pipeline stage '%s' has no valid value" % entry)
+        if ((stage == 'deadband' and not 0.0 <= value < 1.0) or
+                (stage == 'expo' and not 0.0 <= value <= 1.0) or
+                (stage in ('lowpass', 'limit') and value < 0.0)):
+            raise ValueError("pipeline stage '%s' is out of range" % entry)
+        mask = (1 << len(FIELDS)) - 1
+        if len(parts) == 3:
+            names = parts[2].split(',')
+            if not parts[2] or any(name not in FIELDS for name in names):
+                raise ValueError("pipeline stage '%s' names an unknown field" % entry)
+            mask = 0
+            for name in names:
+                mask |= 1 << FIELDS.index(name)
+        stages.append((STAGES.index(stage), mask, value))
+    return stages
+
+
+def compile_profile(p):
+    """Flatten parameters into the CompiledConfig member order."""
+    linear = FIELDS[:3]
+    axis = [p['axis_linear'][f] if f in linear else p['axis_angular'][f] for f in FIELDS]
+    adjustment = [-1 if f in linear else p['axis_angular_adjustment'][f] for f in FIELDS]
+    scale = []
+    for suffix in ['', '_turbo', '_autorun']:
+        scale.append([float(p['scale_linear' + suffix][f]) if f in linear else
+                      float(p['scale_angular' + suffix][f]) for f in FIELDS])
+
+    jog = p['joint_jog']
+    names = list(jog['joint_names'])[:MAX_JOINTS]
+    joint_axis = [jog['axes'][i] if i < len(names) and i < len(jog['axes']) else -1
+                  for i in range(MAX_JOINTS)]
+    normal = [float(jog['scales'][i]) if i < len(jog['scales']) else 0.5 for i in range(MAX_JOINTS)]
+    turbo = [float(jog['scales_turbo'][i]) if i < len(jog['scales_turbo']) else 1.0
+             for i in range(MAX_JOINTS)]
+    gain = [float(v) for v in p['axis_normalization']['gain']][:MAX_AXES]
+    gain += [1.0] * (MAX_AXES - len(gain))
+    offset = [float(v) for v in p['axis_normalization']['offset']][:MAX_AXES]
+    offset += [0.0] * (MAX_AXES - len(offset))
+    pairs = list(p['stick_pairs'])
+    if len(pairs) % 2 or len(pairs) > 2 * MAX_PAIRS or any(a < 0 or a >= MAX_AXES for a in pairs):
+        raise ValueError('stick_pairs must list up to %d pairs of axes below %d' % (MAX_PAIRS, MAX_AXES))
+    num_pairs = len(pairs) // 2
+    if not 0.0 <= float(p['stick_radial_deadzone']) < 1.0:
+        raise ValueError('stick_radial_deadzone must be in [0, 1)')
+    snap_angle = float(p['stick_snap_angle'])
+    snap = math.tan(math.radians(min(max(snap_angle, 0.0), 45.0))) if snap_angle > 0.0 else 0.0
+
+    stages = parse_pipeline(p['pipeline'])
+    padded = stages + [(0, 0, 0.0)] * (MAX_STAGES - len(stages))
+    return {
+        'axis': axis,
+        'adjustment_axis': adjustment,
+        'scale': scale,
+        'require_enable_button': bool(p['require_enable_button']),
+        'enable_button': p['enable_button'],
+        'enable_turbo_button': p['enable_turbo_button'],
+        'enable_autorun_button': p['enable_autorun_button'],
+        'num_joints': len(names),
+        'joint_axis': joint_axis,
+        'joint_scale': [normal, turbo, normal],
+        'num_stages': len(stages),
+        'stages': [list(stage) for stage in padded],
+        'joint_names': names,
+        'pipeline': list(p['pipeline']),
+        'axis_processing': bool(pairs) or any(g != 1.0 for g in gain) or any(o != 0.0 for o in offset),
+        'axis_gain': gain,
+        'axis_offset': offset,
+        'num_pairs': num_pairs,
+        'pair_x': pairs[0::2] + [0] * (MAX_PAIRS - num_pairs),
+        'pair_y': pairs[1::2] + [0] * (MAX_PAIRS - num_pairs),
+        'pair_deadzone': [float(p['stick_radial_deadzone'])] * MAX_PAIRS,
+        'pair_square': [1.0 if p['stick_circle_to_square'] else 0.0] * MAX_PAIRS,
+        'pair_snap': [snap] * MAX_PAIRS,
+    }
+
+
+def cpp_list(values):
+    return '{' + ', '.join(cpp_value(v) for v in values) + '}'
+
+
+def cpp_value(value):
+    if isinstance(value, bool):
+        return 'true' if value else 'false'
+    if isinstance(value, float):
+        return repr(value)
+    if isinstance(value, int):
+        return str(value)
+    return cpp_list(value)
+
+
+def render(config, source):
+    names = ['"%s"' % n for n in config['joint_names']]
+    names += ['nullptr'] * (MAX_JOINTS - len(names))
+    pipeline = ['"%s"' % stage for stage in config['pipeline']]
+    pipeline += ['nullptr'] * (MAX_STAGES - len(pipeline))
+    lines = [
+        '// Generated by generate_fixed_profile.py from %s. Do not edit.' % source,
+        '#ifndef TELEOP_TWIST_JOY_FIXED_PROFILE_H',
+        '#define TELEOP_TWIST_JOY_FIXED_PROFILE_H',
+        '',
+        '// Included by teleop_twist_joy.cpp after compiled_config.hpp.',
+        '',
+        'namespace teleop_twist_joy',
+        '{',
+        '',
+        'constexpr const char* kFixedProfileSource = "%s";' % source,
+        '',
+        'constexpr CompiledConfig kFixedProfile = {',
+    ]
+    for member in ['axis', 'adjustment_axis', 'scale', 'require_enable_button', 'enable_button',
+                   'enable_turbo_button', 'enable_autorun_button', 'num_joints', 'joint_axis',
+                   'joint_scale', 'num_stages', 'stages', 'axis_processing', 'axis_gain',
+                   'axis_offset', 'num_pairs', 'pair_x', 'pair_y', 'pair_deadzone', 'pair_square',
+                   'pair_snap']:
+        lines.append('  %s,  // %s' % (cpp_value(config[member]), member))
+    lines += [
+        '};',
+        '',
+        'constexpr const char* kFixedJointNames[MAX_JOINTS] = {%s};' % ', '.join(names),
+        'constexpr const char* kFixedPipeline[MAX_STAGES] = {%s};' % ', '.join(pipeline),
+        '',
+        '}  // namespace teleop_twist_joy',
+        '',
+        '#endif  // TELEOP_TWIST_JOY_FIXED_PROFILE_H',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+# Must match kProfileDbVersion in src/profile_db.cpp, and CONFIG_FORMAT the CompiledConfig layout.
+DB_VERSION = 1
+CONFIG_FORMAT = ('<6q6q18d?7x4q' + '%dq%dd' % (MAX_JOINTS, 3 * MAX_JOINTS) + 'q' + 'qqd' * MAX_STAGES +
+                 '?7x%dd%ddq' % (MAX_AXES, MAX_AXES) + '%dq%dq%dd%dd%dd' % ((MAX_PAIRS,) * 5))
+CONFIG_SIZE = (struct.calcsize(CONFIG_FORMAT) + 63) // 64 * 64
+SOURCE_SIZE = 64
+PIPELINE_SIZE = 48
+ENTRY_SIZE = CONFIG_SIZE + SOURCE_SIZE + MAX_STAGES * PIPELINE_SIZE
+EMPTY_SLOT = 0xffffffff
+
+
+def profile_key(axes, buttons, device_name):
+    """Mirror of ProfileDb::key(): FNV-1a over the little-endian counts and the name."""
+    h = 14695981039346656037
+    for byte in struct.pack('<II', axes, buttons) + device_name.encode():
+        h = ((h ^ byte) * 1099511628211) & 0xffffffffffffffff
+    return h
+
+
+def pack_string(text, size):
+    data = text.encode()
+    if len(data) >= size:
+        raise ValueError("'%s' is longer than %d bytes" % (text, size - 1))
+    return data + b'\0' * (size - len(data))
+
+
+def pack_entry(config, source):
+    values = []
+    for member in ['axis', 'adjustment_axis', 'scale', 'require_enable_button', 'enable_button',
+                   'enable_turbo_button', 'enable_autorun_button', 'num_joints', 'joint_axis',
+                   'joint_scale', 'num_stages', 'stages', 'axis_processing', 'axis_gain',
+                   'axis_offset', 'num_pairs', 'pair_x', 'pair_y', 'pair_deadzone', 'pair_square',
+                   'pair_snap']:
+        values += flatten(config[member])
+    data = struct.pack(CONFIG_FORMAT, *values)
+    data += b'\0' * (CONFIG_SIZE - len(data))
+    data += pack_string(source, SOURCE_SIZE)
+    for i in range(MAX_STAGES):
+        data += pack_string(config['pipeline'][i] if i < len(config['pipeline']) else '', PIPELINE_SIZE)
+    return data
+
+
+def flatten(value):
+    if isinstance(value, list):
+        return [v for item in value for v in flatten(item)]
+    return [value]
+
+
+def build_database(manifest_path):
+    """Return the database image for the profiles listed in a manifest."""
+    with open(manifest_path) as f:
+        manifest = yaml.safe_load(f) or []
+    base = os.path.dirname(os.path.abspath(manifest_path))
+
+    entries = []
+    keys = {}
+    for item in manifest:
+        path = os.path.join(base, item['config'])
+        key = profile_key(int(item['axes']), int(item['buttons']), item.get('device_name', ''))
+        if key in keys:
+            raise ValueError('%s and %s are for the same controller' % (keys[key], item['config']))
+        keys[key] = item['config']
+        entries.append((key, pack_entry(compile_profile(load_parameters(path)), item['config'])))
+
+    # Open addressing with linear probing, at most half full so probe runs stay short.
+    num_slots = 1
+    while num_slots < 2 * max(len(entries), 1):
+        num_slots *= 2
+    slots = [(0, EMPTY_SLOT)] * num_slots
+    for index, (key, _) in enumerate(entries):
+        slot = key & (num_slots - 1)
+        while slots[slot][1] != EMPTY_SLOT:
+            slot = (slot + 1) & (num_slots - 1)
+        slots[slot] = (key, index)
+
+    slots_offset = 64
+    entries_offset = (slots_offset + 16 * num_slots + 63) // 64 * 64
+    image = b'TTJP' + struct.pack('<5I2Q24x', DB_VERSION, CONFIG_SIZE, ENTRY_SIZE, num_slots, len(entries),
+                                  slots_offset, entries_offset)
+    image += b''.join(struct.pack('<QI4x', key, index) for key, index in slots)
+    image += b'\0' * (entries_offset - len(image))
+    image += b''.join(data for _, data in entries)
+    return image
+
+
+def write_if_changed(path, data, mode):
+    # Only rewrite on change, so an unchanged profile does not rebuild the library.
+    if os.path.exists(path):
+        with open(path, 'r' + mode) as f:
+            if f.read() == data:
+                return
+    with open(path, 'w' + mode) as f:
+        f.write(data)
+
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == '--database':
+        write_if_changed(argv[3], build_database(argv[2]), 'b')
+        return 0
+    if len(argv) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+    config = compile_profile(load_parameters(argv[1]))
+    write_if_changed(argv[2], render(config, os.path.basename(argv[1])), '')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
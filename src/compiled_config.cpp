@@ -0,0 +1,184 @@
+/**
+Software License Agreement (BSD)
+
+\file      compiled_config.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#include "compiled_config.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+
+// FNV-1a, member by member so that padding never enters the hash.
+void mix(uint64_t& hash, const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+}
+
+uint64_t contentHash(const CompiledConfig& c)
+{
+  uint64_t hash = 14695981039346656037ull;
+  mix(hash, c.axis, sizeof(c.axis));
+  mix(hash, c.adjustment_axis, sizeof(c.adjustment_axis));
+  mix(hash, c.scale, sizeof(c.scale));
+  mix(hash, &c.require_enable_button, sizeof(c.require_enable_button));
+  mix(hash, &c.enable_button, sizeof(c.enable_button));
+  mix(hash, &c.enable_turbo_button, sizeof(c.enable_turbo_button));
+  mix(hash, &c.enable_autorun_button, sizeof(c.enable_autorun_button));
+  mix(hash, &c.num_joints, sizeof(c.num_joints));
+  mix(hash, c.joint_axis, sizeof(c.joint_axis));
+  mix(hash, c.joint_scale, sizeof(c.joint_scale));
+  mix(hash, &c.num_stages, sizeof(c.num_stages));
+  for (int64_t i = 0; i < c.num_stages; ++i)
+  {
+    mix(hash, &c.stages[i].type, sizeof(c.stages[i].type));
+    mix(hash, &c.stages[i].field_mask, sizeof(c.stages[i].field_mask));
+    mix(hash, &c.stages[i].value, sizeof(c.stages[i].value));
+  }
+  mix(hash, &c.axis_processing, sizeof(c.axis_processing));
+  mix(hash, c.axis_gain, sizeof(c.axis_gain));
+  mix(hash, c.axis_offset, sizeof(c.axis_offset));
+  mix(hash, &c.num_pairs, sizeof(c.num_pairs));
+  mix(hash, c.pair_x, sizeof(c.pair_x));
+  mix(hash, c.pair_y, sizeof(c.pair_y));
+  mix(hash, c.pair_deadzone, sizeof(c.pair_deadzone));
+  mix(hash, c.pair_square, sizeof(c.pair_square));
+  mix(hash, c.pair_snap, sizeof(c.pair_snap));
+  return hash;
+}
+
+bool sameContents(const CompiledConfig& a, const CompiledConfig& b)
+{
+  return std::memcmp(a.axis, b.axis, sizeof(a.axis)) == 0 &&
+         std::memcmp(a.adjustment_axis, b.adjustment_axis, sizeof(a.adjustment_axis)) == 0 &&
+         std::memcmp(a.scale, b.scale, sizeof(a.scale)) == 0 &&
+         a.require_enable_button == b.require_enable_button &&
+         a.enable_button == b.enable_button &&
+         a.enable_turbo_button == b.enable_turbo_button &&
+         a.enable_autorun_button == b.enable_autorun_button &&
+         a.num_joints == b.num_joints &&
+         std::memcmp(a.joint_axis, b.joint_axis, sizeof(a.joint_axis)) == 0 &&
+         std::memcmp(a.joint_scale, b.joint_scale, sizeof(a.joint_scale)) == 0 &&
+         a.num_stages == b.num_stages &&
+         std::memcmp(a.stages, b.stages, a.num_stages * sizeof(PipelineStage)) == 0 &&
+         a.axis_processing == b.axis_processing &&
+         std::memcmp(a.axis_gain, b.axis_gain, sizeof(a.axis_gain)) == 0 &&
+         std::memcmp(a.axis_offset, b.axis_offset, sizeof(a.axis_offset)) == 0 &&
+         a.num_pairs == b.num_pairs &&
+         std::memcmp(a.pair_x, b.pair_x, sizeof(a.pair_x)) == 0 &&
+         std::memcmp(a.pair_y, b.pair_y, sizeof(a.pair_y)) == 0 &&
+         std::memcmp(a.pair_deadzone, b.pair_deadzone, sizeof(a.pair_deadzone)) == 0 &&
+         std::memcmp(a.pair_square, b.pair_square, sizeof(a.pair_square)) == 0 &&
+         std::memcmp(a.pair_snap, b.pair_snap, sizeof(a.pair_snap)) == 0;
+}
+
+// C++14 operator new does not honour alignas beyond max_align_t, so the table is placed by hand.
+std::shared_ptr<const CompiledConfig> makeAligned(const CompiledConfig& config)
+{
+  void* memory = nullptr;
+  if (posix_memalign(&memory, alignof(CompiledConfig), sizeof(CompiledConfig)) != 0)
+  {
+    throw std::bad_alloc();
+  }
+  return std::shared_ptr<const CompiledConfig>(new (memory) CompiledConfig(config),
+    [](const CompiledConfig* table)
+    {
+      table->~CompiledConfig();
+      std::free(const_cast<CompiledConfig*>(table));
+    });
+}
+
+struct ConfigCache
+{
+  std::mutex mutex;
+  std::unordered_multimap<uint64_t, std::weak_ptr<const CompiledConfig>> entries;
+};
+
+ConfigCache& cache()
+{
+  // Never destroyed, so components unloaded during static destruction still find it.
+  static ConfigCache* instance = new ConfigCache;
+  return *instance;
+}
+
+}  // namespace
+
+std::shared_ptr<const CompiledConfig> internConfig(const CompiledConfig& config)
+{
+  const uint64_t hash = contentHash(config);
+  ConfigCache& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+
+  auto range = c.entries.equal_range(hash);
+  for (auto it = range.first; it != range.second; )
+  {
+    std::shared_ptr<const CompiledConfig> shared = it->second.lock();
+    if (!shared)
+    {
+      it = c.entries.erase(it);
+      continue;
+    }
+    if (sameContents(*shared, config))
+    {
+      return shared;
+    }
+    ++it;
+  }
+
+  // Tables nobody uses any more are dropped here rather than from the deleter, which may run
+  // on any thread.
+  for (auto it = c.entries.begin(); it != c.entries.end(); )
+  {
+    it = it->second.expired() ? c.entries.erase(it) : std::next(it);
+  }
+
+  std::shared_ptr<const CompiledConfig> shared = makeAligned(config);
+  c.entries.emplace(hash, shared);
+  return shared;
+}
+
+size_t internedConfigs()
+{
+  ConfigCache& c = cache();
+  std::lock_guard<std::mutex> lock(c.mutex);
+  size_t live = 0;
+  for (const auto& entry : c.entries)
+  {
+    live += !entry.second.expired();
+  }
+  return live;
+}
+
+}  // namespace teleop_twist_joy
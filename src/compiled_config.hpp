@@ -0,0 +1,158 @@
+/**
+Software License Agreement (BSD)
+
+\file      compiled_config.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_COMPILED_CONFIG_H
+#define TELEOP_TWIST_JOY_COMPILED_CONFIG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <sensor_msgs/msg/joy.hpp>
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Output fields of the Twist, in the order used by CompiledConfig tables.
+ */
+enum ConfigField
+{
+  FIELD_LINEAR_X = 0,
+  FIELD_LINEAR_Y,
+  FIELD_LINEAR_Z,
+  FIELD_ANGULAR_YAW,
+  FIELD_ANGULAR_PITCH,
+  FIELD_ANGULAR_ROLL,
+  NUM_FIELDS
+};
+
+/**
+ * Scale sets, one per scale_* parameter group.
+ */
+enum ConfigScale
+{
+  SCALE_NORMAL = 0,
+  SCALE_TURBO,
+  SCALE_AUTORUN,
+  NUM_SCALES
+};
+
+/**
+ * Upper bound on the joints of the joint_jog output, so the jog tables stay flat like the rest.
+ */
+enum { MAX_JOINTS = 16 };
+
+/**
+ * Input processing stages, applied in order to the stick value of each output field before the
+ * mode scale. See pipeline.hpp.
+ */
+enum StageType
+{
+  STAGE_DEADBAND = 0,
+  STAGE_EXPO,
+  STAGE_LOWPASS,
+  STAGE_SCALE,
+  STAGE_LIMIT,
+  NUM_STAGE_TYPES
+};
+
+enum { MAX_STAGES = 8 };
+
+/**
+ * Bounds of the raw axis conditioning: per-axis normalization of the first MAX_AXES axes and
+ * two-dimensional processing of up to MAX_PAIRS sticks. See stick_processing.hpp.
+ */
+enum { MAX_AXES = 16, MAX_PAIRS = 4 };
+
+struct PipelineStage
+{
+  int64_t type;
+  // Bit i set when the stage applies to ConfigField i.
+  int64_t field_mask;
+  double value;
+};
+
+/**
+ * Mapping compiled from the axis_*, scale_* and button parameters into flat tables indexed by
+ * field, so the per-message path does no string or map lookups. A compiled config is immutable:
+ * parameter changes build a new one and swap it in.
+ *
+ * Cache-line aligned so that a table shared by several instances does not share lines with
+ * anything that is written.
+ */
+struct alignas(64) CompiledConfig
+{
+  int64_t axis[NUM_FIELDS];
+  // Only the angular fields have an adjustment axis; the linear entries are always -1.
+  int64_t adjustment_axis[NUM_FIELDS];
+  double scale[NUM_SCALES][NUM_FIELDS];
+  bool require_enable_button;
+  int64_t enable_button;
+  int64_t enable_turbo_button;
+  int64_t enable_autorun_button;
+  // Joint jog output; autorun has no meaning for an arm, so only the normal and turbo rows are used.
+  int64_t num_joints;
+  int64_t joint_axis[MAX_JOINTS];
+  double joint_scale[NUM_SCALES][MAX_JOINTS];
+  int64_t num_stages;
+  PipelineStage stages[MAX_STAGES];
+  // Raw axis conditioning, applied to the Joy message before anything reads it. Per-pair
+  // settings are stored as plain numbers so the pair loop has no branches to vectorize around.
+  bool axis_processing;
+  double axis_gain[MAX_AXES];
+  double axis_offset[MAX_AXES];
+  int64_t num_pairs;
+  int64_t pair_x[MAX_PAIRS];
+  int64_t pair_y[MAX_PAIRS];
+  double pair_deadzone[MAX_PAIRS];
+  // 1 to stretch the circular stick range to the square, 0 to leave it.
+  double pair_square[MAX_PAIRS];
+  // Tangent of the snap angle: deflections this close to an axis are snapped onto it.
+  double pair_snap[MAX_PAIRS];
+};
+
+/**
+ * Returns the process-wide shared copy of a config, so components in one container with the same
+ * profile read one table. Entries are keyed by a hash of the contents and held weakly: a table is
+ * freed when the last instance using it switches to a different config or is destroyed.
+ */
+std::shared_ptr<const CompiledConfig> internConfig(const CompiledConfig& config);
+
+/**
+ * Number of distinct configs currently shared, for statistics.
+ */
+size_t internedConfigs();
+
+/**
+ * Value of an axis, or 0 when it is unmapped (-1) or missing from the message.
+ */
+inline double axisValue(const sensor_msgs::msg::Joy& joy_msg, int64_t axis)
+{
+  return (axis >= 0 && static_cast<int64_t>(joy_msg.axes.size()) > axis) ? joy_msg.axes[axis] : 0.0;
+}
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_COMPILED_CONFIG_H
@@ -0,0 +1,299 @@
+/**
+Software License Agreement (BSD)
+
+\file      event_log.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "event_log.hpp"
+#include "segment_writer.hpp"
+#include "spsc_ring.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+const char kEventMagic[4] = {'T', 'T', 'J', 'E'};
+const uint32_t kEventVersion = 1;
+const std::chrono::milliseconds kFlushPeriod(50);
+
+// Per-thread backlog between flushes; at 50 ms that is far more than any thread logs.
+enum { RING_CAPACITY = 1024 };
+
+// Each log gets an id that is never reused, so a thread's cached ring for a log that has since
+// been destroyed can never be mistaken for one belonging to a new log.
+std::atomic<uint64_t> next_log_id(1);
+
+const char* const kModeNames[] = {"disabled", "normal", "turbo", "autorun"};
+const char* const kStopReasons[] = {"enable released", "dropout", "macro abort", "output switch"};
+const char* const kRejectReasons[] = {"fixed profile", "wrong type", "invalid value"};
+
+template<size_t N>
+const char* name(const char* const (&names)[N], uint64_t i)
+{
+  return i < N ? names[i] : "unknown";
+}
+}  // namespace
+
+struct ThreadBuffer
+{
+  SpscRing<EventRecord, RING_CAPACITY> ring;
+  std::atomic<uint64_t> dropped;
+  uint64_t reported;  // Flush thread only.
+  uint16_t index;
+
+  explicit ThreadBuffer(uint16_t index) : dropped(0), reported(0), index(index) {}
+};
+
+struct EventLog::Impl
+{
+  ThreadBuffer* threadBuffer();
+  void push(const EventRecord& record);
+  void flushThread();
+  void drain();
+
+  uint64_t id;
+
+  // Taken when a thread logs for the first time and by each drain, never per record. Threads
+  // only hold weak references, so the rings go away with the log.
+  std::mutex buffers_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+  std::thread flush_thread;
+  std::mutex stop_mutex;
+  std::condition_variable stop_cv;
+  bool stop;
+
+  // Flush thread only.
+  std::vector<EventRecord> batch;
+  std::unique_ptr<SegmentWriter> writer;
+};
+
+ThreadBuffer* EventLog::Impl::threadBuffer()
+{
+  // The common case is one log per process, so the last lookup is cached ahead of the map.
+  thread_local uint64_t cached_id = 0;
+  thread_local ThreadBuffer* cached = nullptr;
+  thread_local std::unordered_map<uint64_t, std::weak_ptr<ThreadBuffer>> buffer_for_log;
+
+  if (cached_id == id)
+  {
+    return cached;
+  }
+  std::shared_ptr<ThreadBuffer> buffer = buffer_for_log[id].lock();
+  if (!buffer)
+  {
+    // Entries of logs destroyed since are dropped here, so a thread that outlives many logs
+    // keeps one entry per live log rather than one per log it ever wrote to.
+    for (auto it = buffer_for_log.begin(); it != buffer_for_log.end(); )
+    {
+      it = it->second.expired() && it->first != id ? buffer_for_log.erase(it) : std::next(it);
+    }
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer = std::make_shared<ThreadBuffer>(static_cast<uint16_t>(buffers.size()));
+    buffers.push_back(buffer);
+    buffer_for_log[id] = buffer;
+  }
+  cached_id = id;
+  cached = buffer.get();
+  return cached;
+}
+
+void EventLog::Impl::push(const EventRecord& record)
+{
+  ThreadBuffer* buffer = threadBuffer();
+  EventRecord stamped = record;
+  stamped.thread = buffer->index;
+  if (!buffer->ring.push(stamped))
+  {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void EventLog::Impl::flushThread()
+{
+  std::unique_lock<std::mutex> lock(stop_mutex);
+  while (!stop)
+  {
+    stop_cv.wait_for(lock, kFlushPeriod);
+    lock.unlock();
+    drain();
+    lock.lock();
+  }
+}
+
+void EventLog::Impl::drain()
+{
+  batch.clear();
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers)
+    {
+      EventRecord record;
+      while (buffer->ring.pop(record))
+      {
+        batch.push_back(record);
+      }
+      const uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+      if (dropped != buffer->reported)
+      {
+        EventRecord overflow;
+        overflow.stamp_ns = batch.empty() ? 0 : batch.back().stamp_ns;
+        overflow.type = EVENT_LOG_OVERFLOW;
+        overflow.thread = buffer->index;
+        overflow.arg = buffer->index;
+        overflow.value[0] = static_cast<double>(dropped - buffer->reported);
+        overflow.value[1] = 0.0;
+        batch.push_back(overflow);
+        buffer->reported = dropped;
+      }
+    }
+  }
+  if (batch.empty())
+  {
+    return;
+  }
+
+  // Each ring is in order already; merging them keeps the file in stamp order across threads.
+  std::stable_sort(batch.begin(), batch.end(),
+    [](const EventRecord& a, const EventRecord& b) { return a.stamp_ns < b.stamp_ns; });
+  for (const EventRecord& record : batch)
+  {
+    writer->write(&record, sizeof(record));
+  }
+  writer->flush();
+}
+
+EventLog::EventLog(const std::string& prefix, uint64_t max_file_size, uint32_t max_files)
+{
+  pimpl_ = new Impl;
+  pimpl_->id = next_log_id++;
+  pimpl_->stop = false;
+
+  std::string header(kEventMagic, sizeof(kEventMagic));
+  const uint32_t fields[3] = {kEventVersion, static_cast<uint32_t>(sizeof(EventRecord)), 0};
+  header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+  pimpl_->writer.reset(new SegmentWriter(prefix, ".evlog", header,
+    std::max<uint64_t>(max_file_size, header.size() + sizeof(EventRecord)), max_files));
+
+  pimpl_->flush_thread = std::thread(&Impl::flushThread, pimpl_);
+}
+
+EventLog::~EventLog()
+{
+  {
+    std::lock_guard<std::mutex> lock(pimpl_->stop_mutex);
+    pimpl_->stop = true;
+  }
+  pimpl_->stop_cv.notify_one();
+  pimpl_->flush_thread.join();
+  // Whatever was logged after the last periodic flush.
+  pimpl_->drain();
+  delete pimpl_;
+}
+
+void EventLog::log(int64_t stamp_ns, EventType type, uint32_t arg, double value0, double value1)
+{
+  EventRecord record;
+  record.stamp_ns = stamp_ns;
+  record.type = static_cast<uint16_t>(type);
+  record.thread = 0;
+  record.arg = arg;
+  record.value[0] = value0;
+  record.value[1] = value1;
+  pimpl_->push(record);
+}
+
+void EventLog::logText(int64_t stamp_ns, EventType type, uint32_t arg, const std::string& text)
+{
+  EventRecord record;
+  record.stamp_ns = stamp_ns;
+  record.type = static_cast<uint16_t>(type);
+  record.thread = 0;
+  record.arg = arg;
+  std::memset(record.text, 0, sizeof(record.text));
+  std::memcpy(record.text, text.data(), std::min(text.size(), sizeof(record.text)));
+  pimpl_->push(record);
+}
+
+uint64_t EventLog::dropped() const
+{
+  std::lock_guard<std::mutex> lock(pimpl_->buffers_mutex);
+  uint64_t total = 0;
+  for (const auto& buffer : pimpl_->buffers)
+  {
+    total += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::string describeEvent(const EventRecord& record)
+{
+  char line[128];
+  switch (record.type)
+  {
+    case EVENT_MODE_CHANGE:
+      std::snprintf(line, sizeof(line), "mode_change %s -> %s",
+        name(kModeNames, static_cast<uint64_t>(record.value[0])), name(kModeNames, record.arg));
+      break;
+    case EVENT_AUTORUN_TOGGLE:
+      std::snprintf(line, sizeof(line), "autorun %s", record.arg ? "engaged" : "released");
+      break;
+    case EVENT_OUTPUT_SWITCH:
+      std::snprintf(line, sizeof(line), "output_switch %s", record.arg ? "joint_jog" : "cmd_vel");
+      break;
+    case EVENT_STOP:
+      std::snprintf(line, sizeof(line), "stop %s", name(kStopReasons, record.arg));
+      break;
+    case EVENT_PARAMETER_REJECTED:
+      std::snprintf(line, sizeof(line), "parameter_rejected %.16s %s",
+        record.text, name(kRejectReasons, record.arg));
+      break;
+    case EVENT_MACRO_PLAYBACK:
+      std::snprintf(line, sizeof(line), "macro_playback %.0f commands", record.value[0]);
+      break;
+    case EVENT_LOG_OVERFLOW:
+      std::snprintf(line, sizeof(line), "log_overflow thread %u lost %.0f records",
+        static_cast<unsigned>(record.arg), record.value[0]);
+      break;
+    default:
+      std::snprintf(line, sizeof(line), "unknown type %u arg %u %g %g", static_cast<unsigned>(record.type),
+        static_cast<unsigned>(record.arg), record.value[0], record.value[1]);
+      break;
+  }
+  return line;
+}
+
+}  // namespace teleop_twist_joy
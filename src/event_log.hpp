@@ -0,0 +1,116 @@
+/**
+Software License Agreement (BSD)
+
+\file      event_log.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_EVENT_LOG_H
+#define TELEOP_TWIST_JOY_EVENT_LOG_H
+
+#include <cstdint>
+#include <string>
+
+namespace teleop_twist_joy
+{
+
+enum EventType
+{
+  EVENT_MODE_CHANGE = 1,      // arg: new drive mode, value[0]: previous drive mode
+  EVENT_AUTORUN_TOGGLE,       // arg: 1 when autorun was engaged, 0 when released
+  EVENT_OUTPUT_SWITCH,        // arg: 1 when the sticks now drive joint_jog, 0 for cmd_vel
+  EVENT_STOP,                 // arg: StopReason
+  EVENT_PARAMETER_REJECTED,   // arg: RejectReason, text: parameter name, truncated
+  EVENT_MACRO_PLAYBACK,       // value[0]: number of commands
+  EVENT_LOG_OVERFLOW,         // arg: thread index, value[0]: records lost to that thread's full ring
+  NUM_EVENT_TYPES
+};
+
+enum StopReason
+{
+  STOP_ENABLE_RELEASED = 0,
+  STOP_DROPOUT,
+  STOP_MACRO_ABORT,
+  STOP_OUTPUT_SWITCH
+};
+
+enum RejectReason
+{
+  REJECT_FIXED_PROFILE = 0,
+  REJECT_WRONG_TYPE,
+  REJECT_INVALID_VALUE
+};
+
+/**
+ * One event, 32 bytes on disk and in memory. Drive modes use the node's numbering:
+ * 0 disabled, 1 normal, 2 turbo, 3 autorun.
+ */
+struct EventRecord
+{
+  int64_t stamp_ns;
+  uint16_t type;
+  uint16_t thread;
+  uint32_t arg;
+  union
+  {
+    double value[2];
+    char text[16];
+  };
+};
+
+static_assert(sizeof(EventRecord) == 32, "EventRecord is a fixed on-disk layout");
+
+/**
+ * Human-readable rendering of a record, for the decoder. Never called by the node.
+ */
+std::string describeEvent(const EventRecord& record);
+
+/**
+ * Binary event log. log() only fills a record and pushes it onto a lock-free ring owned by the
+ * calling thread; a background thread drains every ring to prefix.<seq>.evlog about every 50 ms,
+ * starting a new segment once max_file_size is reached and keeping the newest max_files.
+ *
+ * Segment file: "TTJE", a uint32 version, a uint32 record size, a uint32 of zero, then records.
+ */
+class EventLog
+{
+public:
+  EventLog(const std::string& prefix, uint64_t max_file_size, uint32_t max_files);
+  ~EventLog();
+
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  void log(int64_t stamp_ns, EventType type, uint32_t arg = 0, double value0 = 0.0, double value1 = 0.0);
+  void logText(int64_t stamp_ns, EventType type, uint32_t arg, const std::string& text);
+
+  /**
+   * Records lost to full rings so far, across all threads.
+   */
+  uint64_t dropped() const;
+
+private:
+  struct Impl;
+  Impl* pimpl_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_EVENT_LOG_H
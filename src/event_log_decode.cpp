@@ -0,0 +1,81 @@
+/**
+Software License Agreement (BSD)
+
+\file      event_log_decode.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "event_log.hpp"
+
+namespace
+{
+
+bool decode(const char* path)
+{
+  FILE* file = std::fopen(path, "rb");
+  if (!file)
+  {
+    std::fprintf(stderr, "Could not open %s\n", path);
+    return false;
+  }
+
+  char magic[4];
+  uint32_t header[3];
+  if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::fread(header, sizeof(header), 1, file) != 1 ||
+      std::memcmp(magic, "TTJE", sizeof(magic)) != 0 || header[0] != 1 ||
+      header[1] != sizeof(teleop_twist_joy::EventRecord))
+  {
+    std::fprintf(stderr, "%s is not a version 1 event log\n", path);
+    std::fclose(file);
+    return false;
+  }
+
+  teleop_twist_joy::EventRecord record;
+  while (std::fread(&record, sizeof(record), 1, file) == 1)
+  {
+    std::printf("%" PRId64 ".%09" PRId64 " t%u %s\n", record.stamp_ns / 1000000000, record.stamp_ns % 1000000000,
+      static_cast<unsigned>(record.thread), teleop_twist_joy::describeEvent(record).c_str());
+  }
+  std::fclose(file);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::fprintf(stderr, "usage: event_log_decode segment.evlog...\n");
+    return 2;
+  }
+
+  bool ok = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    ok = decode(argv[i]) && ok;
+  }
+  return ok ? 0 : 1;
+}
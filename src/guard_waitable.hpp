@@ -0,0 +1,138 @@
+/**
+Software License Agreement (BSD)
+
+\file      guard_waitable.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_GUARD_WAITABLE_H
+#define TELEOP_TWIST_JOY_GUARD_WAITABLE_H
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp/version.h>
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Runs a callback on the executor whenever another thread calls trigger(). The executor waits
+ * on the guard condition like on a subscription, so nothing wakes up until there is work.
+ */
+class GuardWaitable : public rclcpp::Waitable
+{
+public:
+  GuardWaitable(rclcpp::Context::SharedPtr context, std::function<void()> callback)
+  : guard_condition_(context), callback_(std::move(callback))
+  {
+  }
+
+  /**
+   * Any thread: have the callback run once more on the executor.
+   */
+  void trigger()
+  {
+    guard_condition_.trigger();
+  }
+
+  size_t get_number_of_ready_guard_conditions() override
+  {
+    return 1;
+  }
+
+#if RCLCPP_VERSION_GTE(28, 0, 0)
+  void add_to_wait_set(rcl_wait_set_t& wait_set) override
+  {
+    guard_condition_.add_to_wait_set(wait_set);
+  }
+
+  bool is_ready(const rcl_wait_set_t& wait_set) override
+  {
+    return isReady(wait_set);
+  }
+
+  void execute(const std::shared_ptr<void>&) override
+  {
+    callback_();
+  }
+
+  std::shared_ptr<void> take_data_by_entity_id(size_t) override
+  {
+    return nullptr;
+  }
+
+  void set_on_ready_callback(std::function<void(size_t, int)>) override
+  {
+  }
+
+  void clear_on_ready_callback() override
+  {
+  }
+
+  std::vector<std::shared_ptr<rclcpp::TimerBase>> get_timers() const override
+  {
+    return {};
+  }
+#else
+  void add_to_wait_set(rcl_wait_set_t* wait_set) override
+  {
+    guard_condition_.add_to_wait_set(wait_set);
+  }
+
+  bool is_ready(rcl_wait_set_t* wait_set) override
+  {
+    return isReady(*wait_set);
+  }
+
+  void execute(std::shared_ptr<void>&) override
+  {
+    callback_();
+  }
+#endif
+
+  std::shared_ptr<void> take_data() override
+  {
+    return nullptr;
+  }
+
+private:
+  bool isReady(const rcl_wait_set_t& wait_set) const
+  {
+    for (size_t i = 0; i < wait_set.size_of_guard_conditions; ++i)
+    {
+      if (wait_set.guard_conditions[i] == &guard_condition_.get_rcl_guard_condition())
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  rclcpp::GuardCondition guard_condition_;
+  std::function<void()> callback_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_GUARD_WAITABLE_H
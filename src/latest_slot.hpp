@@ -0,0 +1,86 @@
+/**
+Software License Agreement (BSD)
+
+\file      latest_slot.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_LATEST_SLOT_H
+#define TELEOP_TWIST_JOY_LATEST_SLOT_H
+
+#include <atomic>
+#include <utility>
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Wait-free single-writer, single-reader slot holding the most recent value written (a triple
+ * buffer). The writer never waits for the reader and the reader always sees the latest complete
+ * value; values written in between two reads are dropped.
+ */
+template<typename T>
+class LatestSlot
+{
+public:
+  LatestSlot() : front_(0), middle_(1), back_(2) {}
+
+  /**
+   * Writer side: store a new value.
+   */
+  void write(T value)
+  {
+    buffers_[back_] = std::move(value);
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndexMask;
+  }
+
+  /**
+   * Reader side: true if a value was written since the last read().
+   */
+  bool fresh() const
+  {
+    return (middle_.load(std::memory_order_relaxed) & kFresh) != 0;
+  }
+
+  /**
+   * Reader side: the latest value written, or a default constructed T if there was none yet.
+   */
+  const T& read()
+  {
+    if (fresh())
+    {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    }
+    return buffers_[front_];
+  }
+
+private:
+  static constexpr unsigned kIndexMask = 0x3;
+  static constexpr unsigned kFresh = 0x4;
+
+  T buffers_[3];
+  unsigned front_;
+  std::atomic<unsigned> middle_;
+  unsigned back_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_LATEST_SLOT_H
@@ -0,0 +1,217 @@
+/**
+Software License Agreement (BSD)
+
+\file      link_emulator.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cinttypes>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "teleop_twist_joy/link_emulator.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Internal members of class, following TeleopTwistJoy.
+ */
+struct LinkEmulator::Impl
+{
+  void inputCallback(std::shared_ptr<rclcpp::SerializedMessage> msg);
+  void tickCallback();
+
+  struct Pending
+  {
+    rclcpp::Time release;
+    uint64_t seq;
+    std::shared_ptr<rclcpp::SerializedMessage> msg;
+
+    // Inverted so std::priority_queue pops the earliest release first, in arrival order on ties.
+    bool operator<(const Pending& other) const
+    {
+      return release != other.release ? release > other.release : seq > other.seq;
+    }
+  };
+
+  rclcpp::GenericSubscription::SharedPtr input_sub;
+  rclcpp::GenericPublisher::SharedPtr output_pub;
+  rclcpp::TimerBase::SharedPtr tick_timer;
+  rclcpp::Clock::SharedPtr clock;
+
+  double delay;
+  double jitter;
+  double loss;
+  double burst_loss_start;
+  double burst_loss_stop;
+  double reorder;
+  double reorder_delay;
+
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> uniform;
+  bool in_burst;
+  uint64_t seq;
+  std::priority_queue<Pending> pending;
+
+  uint64_t received;
+  uint64_t lost;
+  uint64_t burst_lost;
+  uint64_t reordered;
+  uint64_t delivered;
+};
+
+/**
+ * Constructs LinkEmulator.
+ */
+LinkEmulator::LinkEmulator(const rclcpp::NodeOptions& options) : Node("link_emulator_node", options)
+{
+  pimpl_ = new Impl{};
+  pimpl_->clock = this->get_clock();
+
+  rcl_interfaces::msg::ParameterDescriptor read_only;
+  read_only.read_only = true;
+
+  std::string message_type = this->declare_parameter("message_type", std::string("sensor_msgs/msg/Joy"), read_only);
+  pimpl_->delay = this->declare_parameter("delay", 0.0, read_only);
+  pimpl_->jitter = this->declare_parameter("jitter", 0.0, read_only);
+  pimpl_->loss = this->declare_parameter("loss", 0.0, read_only);
+  pimpl_->burst_loss_start = this->declare_parameter("burst_loss_start", 0.0, read_only);
+  pimpl_->burst_loss_stop = this->declare_parameter("burst_loss_stop", 1.0, read_only);
+  pimpl_->reorder = this->declare_parameter("reorder", 0.0, read_only);
+  pimpl_->reorder_delay = this->declare_parameter("reorder_delay", 0.05, read_only);
+  int64_t seed = this->declare_parameter("seed", 0, read_only);
+  double tick_period = this->declare_parameter("tick_period", 0.001, read_only);
+
+  // Written so that NaN fails too. A bad setting stops the node rather than quietly emulating a
+  // different link, or spinning on a zero-period timer.
+  auto require = [this](bool valid, const std::string& what)
+  {
+    if (!valid)
+    {
+      RCLCPP_FATAL(this->get_logger(), "%s", what.c_str());
+      // The destructor does not run for a constructor that throws.
+      delete pimpl_;
+      throw std::invalid_argument(what);
+    }
+  };
+  const std::pair<const char*, double> probabilities[] = {
+    {"loss", pimpl_->loss}, {"burst_loss_start", pimpl_->burst_loss_start},
+    {"burst_loss_stop", pimpl_->burst_loss_stop}, {"reorder", pimpl_->reorder}};
+  for (const auto& probability : probabilities)
+  {
+    require(probability.second >= 0.0 && probability.second <= 1.0,
+      std::string(probability.first) + " must be a probability in [0, 1]");
+  }
+  const std::pair<const char*, double> durations[] = {
+    {"delay", pimpl_->delay}, {"jitter", pimpl_->jitter}, {"reorder_delay", pimpl_->reorder_delay}};
+  for (const auto& duration : durations)
+  {
+    require(duration.second >= 0.0 && std::isfinite(duration.second),
+      std::string(duration.first) + " must be a finite, non-negative number of seconds");
+  }
+  require(tick_period >= 1e-6 && std::isfinite(tick_period), "tick_period must be at least a microsecond");
+
+  pimpl_->rng.seed(static_cast<uint64_t>(seed));
+  pimpl_->uniform = std::uniform_real_distribution<double>(0.0, 1.0);
+
+  RCLCPP_INFO(this->get_logger(), "Relaying %s with delay %f s, jitter %f s, loss %f, burst loss %f/%f, "
+    "reorder %f, seed %" PRId64 ".", message_type.c_str(), pimpl_->delay, pimpl_->jitter, pimpl_->loss,
+    pimpl_->burst_loss_start, pimpl_->burst_loss_stop, pimpl_->reorder, seed);
+
+  pimpl_->output_pub = this->create_generic_publisher("output", message_type, rclcpp::QoS(10));
+  pimpl_->input_sub = this->create_generic_subscription("input", message_type, rclcpp::QoS(10),
+    std::bind(&LinkEmulator::Impl::inputCallback, this->pimpl_, std::placeholders::_1));
+  pimpl_->tick_timer = rclcpp::create_timer(this, pimpl_->clock, rclcpp::Duration::from_seconds(tick_period),
+    std::bind(&LinkEmulator::Impl::tickCallback, this->pimpl_));
+}
+
+LinkEmulator::~LinkEmulator()
+{
+  RCLCPP_INFO(this->get_logger(), "Received %" PRIu64 ", lost %" PRIu64 " (%" PRIu64 " in bursts), reordered %" PRIu64
+    ", delivered %" PRIu64 ".", pimpl_->received, pimpl_->lost + pimpl_->burst_lost, pimpl_->burst_lost,
+    pimpl_->reordered, pimpl_->delivered);
+  delete pimpl_;
+}
+
+void LinkEmulator::Impl::inputCallback(std::shared_ptr<rclcpp::SerializedMessage> msg)
+{
+  ++received;
+
+  // Two-state Gilbert-Elliott model: in the bad state every message is lost.
+  if (in_burst)
+  {
+    in_burst = uniform(rng) >= burst_loss_stop;
+  }
+  else
+  {
+    in_burst = uniform(rng) < burst_loss_start;
+  }
+  if (in_burst)
+  {
+    ++burst_lost;
+    return;
+  }
+  if (uniform(rng) < loss)
+  {
+    ++lost;
+    return;
+  }
+
+  double latency = delay + jitter * uniform(rng);
+  if (uniform(rng) < reorder)
+  {
+    // Held back long enough for later messages to overtake it.
+    latency += reorder_delay;
+    ++reordered;
+  }
+
+  const rclcpp::Time release = clock->now() + rclcpp::Duration::from_seconds(latency);
+  pending.push(Pending{release, seq++, msg});
+  if (latency <= 0.0)
+  {
+    tickCallback();
+  }
+}
+
+void LinkEmulator::Impl::tickCallback()
+{
+  const auto now = clock->now();
+  while (!pending.empty() && pending.top().release <= now)
+  {
+    output_pub->publish(*pending.top().msg);
+    pending.pop();
+    ++delivered;
+  }
+}
+
+}  // namespace teleop_twist_joy
+
+RCLCPP_COMPONENTS_REGISTER_NODE(teleop_twist_joy::LinkEmulator)
@@ -0,0 +1,151 @@
+/**
+Software License Agreement (BSD)
+
+\file      macro.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "macro.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+const char kMacroMagic[4] = {'T', 'T', 'J', 'M'};
+const uint32_t kMacroVersion = 1;
+}  // namespace
+
+Macro::Macro(size_t capacity) : capacity_(capacity)
+{
+  samples_.reserve(capacity_);
+}
+
+void Macro::clear()
+{
+  samples_.clear();
+}
+
+bool Macro::record(int64_t offset_ns, const geometry_msgs::msg::Twist& cmd_vel)
+{
+  if (full())
+  {
+    return false;
+  }
+  MacroSample sample;
+  sample.offset_ns = offset_ns;
+  sample.values[FIELD_LINEAR_X] = cmd_vel.linear.x;
+  sample.values[FIELD_LINEAR_Y] = cmd_vel.linear.y;
+  sample.values[FIELD_LINEAR_Z] = cmd_vel.linear.z;
+  sample.values[FIELD_ANGULAR_YAW] = cmd_vel.angular.z;
+  sample.values[FIELD_ANGULAR_PITCH] = cmd_vel.angular.y;
+  sample.values[FIELD_ANGULAR_ROLL] = cmd_vel.angular.x;
+  samples_.push_back(sample);
+  return true;
+}
+
+void Macro::toTwist(const MacroSample& sample, geometry_msgs::msg::Twist& cmd_vel)
+{
+  cmd_vel.linear.x = sample.values[FIELD_LINEAR_X];
+  cmd_vel.linear.y = sample.values[FIELD_LINEAR_Y];
+  cmd_vel.linear.z = sample.values[FIELD_LINEAR_Z];
+  cmd_vel.angular.z = sample.values[FIELD_ANGULAR_YAW];
+  cmd_vel.angular.y = sample.values[FIELD_ANGULAR_PITCH];
+  cmd_vel.angular.x = sample.values[FIELD_ANGULAR_ROLL];
+}
+
+bool Macro::save(const std::string& path) const
+{
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    return false;
+  }
+  const uint64_t count = samples_.size();
+  bool ok = std::fwrite(kMacroMagic, sizeof(kMacroMagic), 1, file) == 1 &&
+            std::fwrite(&kMacroVersion, sizeof(kMacroVersion), 1, file) == 1 &&
+            std::fwrite(&count, sizeof(count), 1, file) == 1 &&
+            (count == 0 || std::fwrite(samples_.data(), sizeof(MacroSample), count, file) == count);
+  ok = std::fclose(file) == 0 && ok;
+  return ok;
+}
+
+bool Macro::load(const std::string& path, std::string& error)
+{
+  samples_.clear();
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    error = "cannot open " + path;
+    return false;
+  }
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t count = 0;
+  bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 && std::memcmp(magic, kMacroMagic, 4) == 0 &&
+            std::fread(&version, sizeof(version), 1, file) == 1 && version == kMacroVersion &&
+            std::fread(&count, sizeof(count), 1, file) == 1;
+  if (!ok)
+  {
+    error = path + " is not a version " + std::to_string(kMacroVersion) + " macro";
+  }
+  // The count is only trusted once the rest of the file holds exactly that many samples and
+  // they fit in the buffer, so a corrupt or truncated file cannot make it allocate at will.
+  long remaining = -1;
+  if (ok)
+  {
+    const long header = std::ftell(file);
+    ok = header >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+    remaining = ok ? std::ftell(file) - header : -1;
+    ok = ok && std::fseek(file, header, SEEK_SET) == 0;
+  }
+  if (ok && count > capacity_)
+  {
+    error = path + " holds " + std::to_string(count) + " commands, more than macro_max_samples";
+    ok = false;
+  }
+  else if (ok && (remaining < 0 || count != static_cast<uint64_t>(remaining) / sizeof(MacroSample) ||
+                  static_cast<uint64_t>(remaining) % sizeof(MacroSample) != 0))
+  {
+    error = path + " does not hold the " + std::to_string(count) + " commands its header declares";
+    ok = false;
+  }
+  if (ok)
+  {
+    samples_.resize(count);
+    ok = count == 0 || std::fread(samples_.data(), sizeof(MacroSample), count, file) == count;
+    if (!ok)
+    {
+      error = "cannot read " + path;
+    }
+  }
+  if (!ok)
+  {
+    samples_.clear();
+  }
+  std::fclose(file);
+  return ok;
+}
+
+}  // namespace teleop_twist_joy
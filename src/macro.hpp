@@ -0,0 +1,84 @@
+/**
+Software License Agreement (BSD)
+
+\file      macro.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_MACRO_H
+#define TELEOP_TWIST_JOY_MACRO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <geometry_msgs/msg/twist.hpp>
+
+#include "compiled_config.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * One recorded command, stamped relative to the start of the recording.
+ */
+struct MacroSample
+{
+  int64_t offset_ns;
+  float values[NUM_FIELDS];
+};
+
+/**
+ * A recorded maneuver: the command stream as published, in a buffer sized once up front.
+ */
+class Macro
+{
+public:
+  explicit Macro(size_t capacity = 0);
+
+  void clear();
+  bool full() const { return samples_.size() >= capacity_; }
+  bool empty() const { return samples_.empty(); }
+  size_t size() const { return samples_.size(); }
+  const MacroSample& operator[](size_t i) const { return samples_[i]; }
+
+  /**
+   * Appends a command; returns false when the buffer is full.
+   */
+  bool record(int64_t offset_ns, const geometry_msgs::msg::Twist& cmd_vel);
+
+  static void toTwist(const MacroSample& sample, geometry_msgs::msg::Twist& cmd_vel);
+
+  /**
+   * Binary file: "TTJM", a uint32 version, a uint64 sample count, then the raw samples. load
+   * rejects a file whose count does not match its size or exceeds the capacity, returning false
+   * with a reason and leaving the macro empty.
+   */
+  bool save(const std::string& path) const;
+  bool load(const std::string& path, std::string& error);
+
+private:
+  size_t capacity_;
+  std::vector<MacroSample> samples_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_MACRO_H
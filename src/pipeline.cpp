@@ -0,0 +1,125 @@
+/**
+Software License Agreement (BSD)
+
+\file      pipeline.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+
+bool parseFields(const std::string& list, int64_t& mask)
+{
+  static const char* field_names[NUM_FIELDS] = {"x", "y", "z", "yaw", "pitch", "roll"};
+  mask = 0;
+  std::stringstream stream(list);
+  std::string name;
+  while (std::getline(stream, name, ','))
+  {
+    int field = 0;
+    while (field < NUM_FIELDS && name != field_names[field])
+    {
+      ++field;
+    }
+    if (field == NUM_FIELDS)
+    {
+      return false;
+    }
+    mask |= int64_t(1) << field;
+  }
+  return mask != 0;
+}
+
+}  // namespace
+
+bool parsePipeline(const std::vector<std::string>& spec, CompiledConfig& config, std::string& error)
+{
+  static const char* stage_names[NUM_STAGE_TYPES] = {"deadband", "expo", "lowpass", "scale", "limit"};
+
+  if (spec.size() > MAX_STAGES)
+  {
+    error = "at most " + std::to_string(static_cast<int>(MAX_STAGES)) + " pipeline stages are supported";
+    return false;
+  }
+
+  PipelineStage stages[MAX_STAGES];
+  for (size_t i = 0; i < spec.size(); ++i)
+  {
+    const std::string& entry = spec[i];
+    const size_t colon = entry.find(':');
+    const size_t fields = colon == std::string::npos ? std::string::npos : entry.find(':', colon + 1);
+    const std::string name = entry.substr(0, colon);
+
+    int type = 0;
+    while (type < NUM_STAGE_TYPES && name != stage_names[type])
+    {
+      ++type;
+    }
+    if (type == NUM_STAGE_TYPES || colon == std::string::npos)
+    {
+      error = "pipeline stage '" + entry + "' is not <deadband|expo|lowpass|scale|limit>:<value>[:<fields>]";
+      return false;
+    }
+
+    const std::string number = entry.substr(colon + 1, fields == std::string::npos ? fields : fields - colon - 1);
+    char* end = nullptr;
+    const double value = std::strtod(number.c_str(), &end);
+    if (number.empty() || *end != '\0' || !std::isfinite(value))
+    {
+      error = "pipeline stage '" + entry + "' has no valid value";
+      return false;
+    }
+    if ((type == STAGE_DEADBAND && (value < 0.0 || value >= 1.0)) ||
+        (type == STAGE_EXPO && (value < 0.0 || value > 1.0)) ||
+        ((type == STAGE_LOWPASS || type == STAGE_LIMIT) && value < 0.0))
+    {
+      error = "pipeline stage '" + entry + "' is out of range";
+      return false;
+    }
+
+    int64_t mask = (int64_t(1) << NUM_FIELDS) - 1;
+    if (fields != std::string::npos && !parseFields(entry.substr(fields + 1), mask))
+    {
+      error = "pipeline stage '" + entry + "' names an unknown field";
+      return false;
+    }
+    stages[i] = PipelineStage{type, mask, value};
+  }
+
+  config.num_stages = static_cast<int64_t>(spec.size());
+  for (size_t i = 0; i < MAX_STAGES; ++i)
+  {
+    config.stages[i] = i < spec.size() ? stages[i] : PipelineStage{0, 0, 0.0};
+  }
+  return true;
+}
+
+}  // namespace teleop_twist_joy
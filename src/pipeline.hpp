@@ -0,0 +1,141 @@
+/**
+Software License Agreement (BSD)
+
+\file      pipeline.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_PIPELINE_H
+#define TELEOP_TWIST_JOY_PIPELINE_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "compiled_config.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Parses the pipeline parameter into config.stages. Each entry is "<stage>:<value>[:<fields>]",
+ * e.g. "deadband:0.05", "expo:0.3:x,yaw" or "lowpass:0.1", where fields is a comma separated
+ * list of x, y, z, yaw, pitch and roll (all fields when omitted). Returns false with a reason on
+ * error, leaving config untouched.
+ */
+bool parsePipeline(const std::vector<std::string>& spec, CompiledConfig& config, std::string& error);
+
+/**
+ * Per-instance state of the stateful stages, kept out of the shared config.
+ */
+struct PipelineState
+{
+  double lowpass[MAX_STAGES][NUM_FIELDS];
+  bool primed;
+};
+
+inline void resetPipeline(PipelineState& state)
+{
+  for (int64_t i = 0; i < MAX_STAGES; ++i)
+  {
+    for (int field = 0; field < NUM_FIELDS; ++field)
+    {
+      state.lowpass[i][field] = 0.0;
+    }
+  }
+  state.primed = false;
+}
+
+/**
+ * Runs the compiled stages over the stick values of all fields. The stages are fused: each field
+ * is read once and carried through the whole stage list in a local before the next one, instead
+ * of one sweep over the fields per stage. The stage list is fixed when the config is compiled, so
+ * the inner step is a switch over plain data: no allocation and no virtual calls. dt is the time
+ * since the previous run, for the low-pass stages.
+ *
+ * timer.begin() and timer.end(stage) bracket every stage step; NoStageTimer compiles them away.
+ */
+template<typename Timer>
+inline void runPipeline(const CompiledConfig& cfg, PipelineState& state, double dt,
+                        double values[NUM_FIELDS], Timer& timer)
+{
+  // Low-pass gains only depend on dt, so they are worked out once per run rather than per field.
+  double alpha[MAX_STAGES];
+  for (int64_t i = 0; i < cfg.num_stages; ++i)
+  {
+    const double v = cfg.stages[i].value;
+    alpha[i] = v > 0.0 ? dt / (v + dt) : 1.0;
+  }
+
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    double x = values[field];
+    for (int64_t i = 0; i < cfg.num_stages; ++i)
+    {
+      const PipelineStage& stage = cfg.stages[i];
+      if (!((stage.field_mask >> field) & 1))
+      {
+        continue;
+      }
+      const double v = stage.value;
+      timer.begin();
+      switch (stage.type)
+      {
+        case STAGE_DEADBAND:
+          // Rescaled so the output still spans the full range outside the deadband.
+          x = std::abs(x) <= v ? 0.0 : std::copysign((std::abs(x) - v) / (1.0 - v), x);
+          break;
+        case STAGE_EXPO:
+          x = (1.0 - v) * x + v * x * x * x;
+          break;
+        case STAGE_LOWPASS:
+        {
+          // First run after a reset starts from the input instead of ramping up from zero.
+          double& filtered = state.lowpass[i][field];
+          filtered = state.primed ? filtered + alpha[i] * (x - filtered) : x;
+          x = filtered;
+          break;
+        }
+        case STAGE_SCALE:
+          x *= v;
+          break;
+        case STAGE_LIMIT:
+          x = x > v ? v : (x < -v ? -v : x);
+          break;
+      }
+      timer.end(i);
+    }
+    values[field] = x;
+  }
+  state.primed = true;
+}
+
+/**
+ * Timer for runPipeline that compiles away.
+ */
+struct NoStageTimer
+{
+  void begin() {}
+  void end(int64_t) {}
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_PIPELINE_H
@@ -0,0 +1,295 @@
+/**
+Software License Agreement (BSD)
+
+\file      profile_db.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "profile_db.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+const char kProfileDbMagic[4] = {'T', 'T', 'J', 'P'};
+// Bump together with scripts/generate_fixed_profile.py whenever CompiledConfig changes layout.
+const uint32_t kProfileDbVersion = 1;
+const uint32_t kEmptySlot = 0xffffffff;
+// Axis and button indices past this are not something a Joy driver reports; rejecting them keeps
+// the node from growing messages to match.
+const int64_t kMaxIndex = 1024;
+
+bool validIndex(int64_t index)
+{
+  return index >= -1 && index < kMaxIndex;
+}
+
+/**
+ * True when count table rows starting at offset lie within a file of the given length, without
+ * the sum overflowing.
+ */
+bool fits(uint64_t offset, uint64_t count, uint64_t row_size, uint64_t length)
+{
+  return offset <= length && count <= (length - offset) / row_size;
+}
+
+/**
+ * Checks that the node can use an entry as is: every count within its table and every index it
+ * dereferences in range. The file may come from anywhere, so the generator's checks are not
+ * relied on.
+ */
+bool validEntry(const ProfileDbEntry& entry)
+{
+  const CompiledConfig& cfg = entry.config;
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    if (!validIndex(cfg.axis[field]) || !validIndex(cfg.adjustment_axis[field]))
+    {
+      return false;
+    }
+  }
+  if (!validIndex(cfg.enable_button) || !validIndex(cfg.enable_turbo_button) ||
+      !validIndex(cfg.enable_autorun_button))
+  {
+    return false;
+  }
+  if (cfg.num_joints < 0 || cfg.num_joints > MAX_JOINTS ||
+      cfg.num_stages < 0 || cfg.num_stages > MAX_STAGES ||
+      cfg.num_pairs < 0 || cfg.num_pairs > MAX_PAIRS)
+  {
+    return false;
+  }
+  for (int64_t joint = 0; joint < cfg.num_joints; ++joint)
+  {
+    if (!validIndex(cfg.joint_axis[joint]))
+    {
+      return false;
+    }
+  }
+  for (int64_t i = 0; i < cfg.num_stages; ++i)
+  {
+    const PipelineStage& stage = cfg.stages[i];
+    if (stage.type < 0 || stage.type >= NUM_STAGE_TYPES || !std::isfinite(stage.value))
+    {
+      return false;
+    }
+  }
+  for (int64_t p = 0; p < cfg.num_pairs; ++p)
+  {
+    if (cfg.pair_x[p] < 0 || cfg.pair_x[p] >= MAX_AXES || cfg.pair_y[p] < 0 || cfg.pair_y[p] >= MAX_AXES)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+struct ProfileDb::Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t config_size;
+  uint32_t entry_size;
+  uint32_t num_slots;
+  uint32_t num_entries;
+  uint64_t slots_offset;
+  uint64_t entries_offset;
+  char reserved[24];
+};
+
+struct ProfileDb::Slot
+{
+  uint64_t key;
+  uint32_t entry;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(ProfileDbEntry) % 64 == 0, "entries are stored back to back at 64-byte alignment");
+
+ProfileDb::ProfileDb() : data_(nullptr), length_(0), header_(nullptr), slots_(nullptr), entries_(nullptr)
+{
+}
+
+ProfileDb::~ProfileDb()
+{
+  close();
+}
+
+void ProfileDb::close()
+{
+  if (data_)
+  {
+    munmap(data_, length_);
+  }
+  data_ = nullptr;
+  length_ = 0;
+  header_ = nullptr;
+  slots_ = nullptr;
+  entries_ = nullptr;
+}
+
+bool ProfileDb::open(const std::string& path, std::string& error)
+{
+  static_assert(sizeof(Header) == 64, "the header layout is fixed");
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    error = "cannot open " + path;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+  {
+    ::close(fd);
+    error = path + " is too short";
+    return false;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    error = "cannot map " + path;
+    return false;
+  }
+  data_ = data;
+  length_ = st.st_size;
+
+  const Header* header = static_cast<const Header*>(data_);
+  if (std::memcmp(header->magic, kProfileDbMagic, sizeof(kProfileDbMagic)) != 0 ||
+      header->version != kProfileDbVersion)
+  {
+    error = path + " is not a version " + std::to_string(kProfileDbVersion) + " profile database";
+  }
+  else if (header->config_size != sizeof(CompiledConfig) || header->entry_size != sizeof(ProfileDbEntry))
+  {
+    error = path + " was generated for a different build of the node";
+  }
+  else if (header->num_slots == 0 || (header->num_slots & (header->num_slots - 1)) != 0 ||
+           header->slots_offset % alignof(Slot) != 0 || header->entries_offset % 64 != 0 ||
+           !fits(header->slots_offset, header->num_slots, sizeof(Slot), length_) ||
+           !fits(header->entries_offset, header->num_entries, sizeof(ProfileDbEntry), length_))
+  {
+    error = path + " is corrupt";
+  }
+  if (!error.empty())
+  {
+    close();
+    return false;
+  }
+
+  const Slot* slots = reinterpret_cast<const Slot*>(static_cast<const char*>(data_) + header->slots_offset);
+  const ProfileDbEntry* entries =
+    reinterpret_cast<const ProfileDbEntry*>(static_cast<const char*>(data_) + header->entries_offset);
+  for (uint32_t i = 0; i < header->num_slots && error.empty(); ++i)
+  {
+    if (slots[i].entry != kEmptySlot && slots[i].entry >= header->num_entries)
+    {
+      error = path + " is corrupt: slot " + std::to_string(i) + " points past the entries";
+    }
+  }
+  for (uint32_t i = 0; i < header->num_entries && error.empty(); ++i)
+  {
+    if (!validEntry(entries[i]))
+    {
+      error = path + " is corrupt: entry " + std::to_string(i) + " is out of range";
+    }
+  }
+  if (!error.empty())
+  {
+    close();
+    return false;
+  }
+
+  header_ = header;
+  slots_ = slots;
+  entries_ = entries;
+  return true;
+}
+
+const ProfileDbEntry* ProfileDb::find(uint32_t axes, uint32_t buttons, const std::string& device_name) const
+{
+  if (!header_)
+  {
+    return nullptr;
+  }
+  const ProfileDbEntry* entry = device_name.empty() ? nullptr : lookup(key(axes, buttons, device_name));
+  return entry ? entry : lookup(key(axes, buttons, std::string()));
+}
+
+size_t ProfileDb::size() const
+{
+  return header_ ? header_->num_entries : 0;
+}
+
+uint64_t ProfileDb::key(uint32_t axes, uint32_t buttons, const std::string& device_name)
+{
+  // FNV-1a over the little-endian counts and the name, as in the generator.
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](uint8_t byte)
+  {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  };
+  for (int shift = 0; shift < 32; shift += 8)
+  {
+    mix(static_cast<uint8_t>(axes >> shift));
+  }
+  for (int shift = 0; shift < 32; shift += 8)
+  {
+    mix(static_cast<uint8_t>(buttons >> shift));
+  }
+  for (char c : device_name)
+  {
+    mix(static_cast<uint8_t>(c));
+  }
+  return hash;
+}
+
+const ProfileDbEntry* ProfileDb::lookup(uint64_t key) const
+{
+  const uint32_t mask = header_->num_slots - 1;
+  for (uint32_t probe = 0; probe < header_->num_slots; ++probe)
+  {
+    const Slot& slot = slots_[(key + probe) & mask];
+    if (slot.entry == kEmptySlot)
+    {
+      return nullptr;
+    }
+    if (slot.key == key && slot.entry < header_->num_entries)
+    {
+      return &entries_[slot.entry];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace teleop_twist_joy
@@ -0,0 +1,97 @@
+/**
+Software License Agreement (BSD)
+
+\file      profile_db.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_PROFILE_DB_H
+#define TELEOP_TWIST_JOY_PROFILE_DB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "compiled_config.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * One controller profile as stored in the database: the compiled mapping, ready to use as is,
+ * plus the strings the parameters report.
+ */
+struct ProfileDbEntry
+{
+  CompiledConfig config;
+  char source[64];
+  char pipeline[MAX_STAGES][48];
+};
+
+/**
+ * Read-only, memory-mapped database of controller profiles, written by
+ * scripts/generate_fixed_profile.py --database. Profiles are found through an open-addressing
+ * hash table keyed by the Joy shape (axes and buttons counts) and optionally the device name.
+ *
+ * File: a 64-byte header ("TTJP", version, sizeof(CompiledConfig), sizeof(ProfileDbEntry),
+ * slot count, entry count, slot offset, entry offset), the slots, then the entries.
+ */
+class ProfileDb
+{
+public:
+  ProfileDb();
+  ~ProfileDb();
+
+  ProfileDb(const ProfileDb&) = delete;
+  ProfileDb& operator=(const ProfileDb&) = delete;
+
+  /**
+   * Maps the file and checks all of it up front: the table bounds against the file length, and
+   * every entry's counts and indices against the CompiledConfig limits. Any failure rejects the
+   * whole database, returning false with a reason.
+   */
+  bool open(const std::string& path, std::string& error);
+
+  /**
+   * The profile for this shape and device name, else the one for the shape alone, else null.
+   */
+  const ProfileDbEntry* find(uint32_t axes, uint32_t buttons, const std::string& device_name) const;
+
+  size_t size() const;
+
+  static uint64_t key(uint32_t axes, uint32_t buttons, const std::string& device_name);
+
+private:
+  struct Header;
+  struct Slot;
+
+  const ProfileDbEntry* lookup(uint64_t key) const;
+  void close();
+
+  void* data_;
+  size_t length_;
+  const Header* header_;
+  const Slot* slots_;
+  const ProfileDbEntry* entries_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_PROFILE_DB_H
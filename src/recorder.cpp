@@ -0,0 +1,470 @@
+/**
+Software License Agreement (BSD)
+
+\file      recorder.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "recorder.hpp"
+#include "segment_writer.hpp"
+#include "spsc_ring.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+const char kRecordMagic[4] = {'T', 'T', 'J', 'R'};
+const uint32_t kRecordVersion = 1;
+const std::chrono::milliseconds kDrainPeriod(100);
+// Partial blocks are written after this many drains, bounding what a crash can lose to ~1 s.
+const int kDrainsPerFlush = 10;
+
+// Axes come from 16-bit drivers, so this keeps every step they can report.
+const double kQuantization[NUM_STREAMS] = {32767.0, 10000.0};
+
+// Enough for a 4 kHz batched device between drains.
+enum { RING_CAPACITY = 4096, BLOCK_SAMPLES = 1024 };
+
+struct RawSample
+{
+  int64_t stamp_ns;
+  uint8_t stream;
+  uint8_t num_values;
+  uint8_t num_buttons;
+  uint32_t buttons;
+  float values[RECORD_MAX_AXES];
+};
+
+uint64_t zigzag(int64_t v)
+{
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v)
+{
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void putVarint(std::string& out, uint64_t v)
+{
+  while (v >= 0x80)
+  {
+    out.push_back(static_cast<char>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7)
+  {
+    const uint8_t byte = *p++;
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Samples of one stream with one shape, kept as quantized columns until encoded.
+ */
+struct Block
+{
+  int stream = 0;
+  size_t num_values = 0;
+  size_t num_buttons = 0;
+  std::vector<int64_t> stamps;
+  std::vector<std::vector<int32_t>> values;
+  std::vector<std::vector<uint8_t>> buttons;
+
+  void reset(int new_stream, size_t new_values, size_t new_buttons)
+  {
+    stream = new_stream;
+    num_values = new_values;
+    num_buttons = new_buttons;
+    stamps.clear();
+    values.resize(num_values);
+    buttons.resize(num_buttons);
+    for (auto& column : values)
+    {
+      column.clear();
+    }
+    for (auto& column : buttons)
+    {
+      column.clear();
+    }
+  }
+
+  void append(const RawSample& sample)
+  {
+    stamps.push_back(sample.stamp_ns);
+    const double scale = kQuantization[stream];
+    for (size_t i = 0; i < num_values; ++i)
+    {
+      const double q = std::round(sample.values[i] * scale);
+      values[i].push_back(static_cast<int32_t>(std::max(-2147483647.0, std::min(2147483647.0, q))));
+    }
+    for (size_t i = 0; i < num_buttons; ++i)
+    {
+      buttons[i].push_back((sample.buttons >> i) & 1);
+    }
+  }
+
+  /**
+   * Payload: stream, count, value and button column counts, then the stamp column, the value
+   * columns and the button columns, all as varints.
+   */
+  void encode(std::string& out) const
+  {
+    putVarint(out, stream);
+    putVarint(out, stamps.size());
+    putVarint(out, num_values);
+    putVarint(out, num_buttons);
+    int64_t previous = 0;
+    for (int64_t stamp : stamps)
+    {
+      putVarint(out, zigzag(stamp - previous));
+      previous = stamp;
+    }
+    for (const auto& column : values)
+    {
+      int64_t last = 0;
+      for (int32_t q : column)
+      {
+        putVarint(out, zigzag(static_cast<int64_t>(q) - last));
+        last = q;
+      }
+    }
+    // First state, then the lengths of alternating runs; buttons rarely change, so most of a
+    // block is one or two runs.
+    for (const auto& column : buttons)
+    {
+      putVarint(out, column.empty() ? 0 : column[0]);
+      size_t run = 0;
+      for (size_t i = 0; i < column.size(); ++i)
+      {
+        if (i > 0 && column[i] != column[i - 1])
+        {
+          putVarint(out, run);
+          run = 0;
+        }
+        ++run;
+      }
+      putVarint(out, run);
+    }
+  }
+};
+}  // namespace
+
+struct Recorder::Impl
+{
+  void push(const RawSample& sample);
+  void writerThread();
+  void drain();
+  void writeBlock(Block& block);
+
+  SpscRing<RawSample, RING_CAPACITY> ring;
+  std::atomic<uint64_t> dropped;
+
+  std::thread writer_thread;
+  std::mutex stop_mutex;
+  std::condition_variable stop_cv;
+  bool stop;
+
+  // Writer thread only.
+  Block blocks[NUM_STREAMS];
+  std::string encoded;
+  std::unique_ptr<SegmentWriter> writer;
+};
+
+void Recorder::Impl::push(const RawSample& sample)
+{
+  if (!ring.push(sample))
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Recorder::Impl::writerThread()
+{
+  std::unique_lock<std::mutex> lock(stop_mutex);
+  for (int drains = 1; !stop; ++drains)
+  {
+    stop_cv.wait_for(lock, kDrainPeriod);
+    lock.unlock();
+    drain();
+    if (drains % kDrainsPerFlush == 0)
+    {
+      for (Block& block : blocks)
+      {
+        writeBlock(block);
+      }
+      writer->flush();
+    }
+    lock.lock();
+  }
+}
+
+void Recorder::Impl::drain()
+{
+  RawSample sample;
+  while (ring.pop(sample))
+  {
+    Block& block = blocks[sample.stream];
+    if (block.num_values != sample.num_values || block.num_buttons != sample.num_buttons)
+    {
+      // A controller with a different shape starts a new block.
+      writeBlock(block);
+      block.reset(sample.stream, sample.num_values, sample.num_buttons);
+    }
+    block.append(sample);
+    if (block.stamps.size() >= BLOCK_SAMPLES)
+    {
+      writeBlock(block);
+    }
+  }
+}
+
+void Recorder::Impl::writeBlock(Block& block)
+{
+  if (block.stamps.empty())
+  {
+    return;
+  }
+  encoded.assign(4, '\0');
+  block.encode(encoded);
+  const uint32_t length = static_cast<uint32_t>(encoded.size() - 4);
+  std::memcpy(&encoded[0], &length, sizeof(length));
+  writer->write(encoded.data(), encoded.size());
+  block.reset(block.stream, block.num_values, block.num_buttons);
+}
+
+Recorder::Recorder(const std::string& prefix, uint64_t max_file_size, uint32_t max_files)
+{
+  pimpl_ = new Impl;
+  pimpl_->dropped = 0;
+  pimpl_->stop = false;
+  for (int stream = 0; stream < NUM_STREAMS; ++stream)
+  {
+    pimpl_->blocks[stream].reset(stream, 0, 0);
+  }
+
+  // "TTJR", a uint32 version, a uint32 of zero and the quantization factor of each stream.
+  std::string header(kRecordMagic, sizeof(kRecordMagic));
+  const uint32_t fields[2] = {kRecordVersion, 0};
+  header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+  header.append(reinterpret_cast<const char*>(kQuantization), sizeof(kQuantization));
+  pimpl_->writer.reset(new SegmentWriter(prefix, ".ttjr", header, max_file_size, max_files));
+
+  pimpl_->writer_thread = std::thread(&Impl::writerThread, pimpl_);
+}
+
+Recorder::~Recorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(pimpl_->stop_mutex);
+    pimpl_->stop = true;
+  }
+  pimpl_->stop_cv.notify_one();
+  pimpl_->writer_thread.join();
+  pimpl_->drain();
+  for (Block& block : pimpl_->blocks)
+  {
+    pimpl_->writeBlock(block);
+  }
+  pimpl_->writer->flush();
+  delete pimpl_;
+}
+
+void Recorder::recordInput(int64_t stamp_ns, const float* axes, size_t num_axes, const int32_t* buttons,
+                           size_t num_buttons)
+{
+  RawSample sample;
+  sample.stamp_ns = stamp_ns;
+  sample.stream = STREAM_INPUT;
+  sample.num_values = static_cast<uint8_t>(std::min<size_t>(num_axes, RECORD_MAX_AXES));
+  sample.num_buttons = static_cast<uint8_t>(std::min<size_t>(num_buttons, RECORD_MAX_BUTTONS));
+  std::copy(axes, axes + sample.num_values, sample.values);
+  sample.buttons = 0;
+  for (size_t i = 0; i < sample.num_buttons; ++i)
+  {
+    sample.buttons |= static_cast<uint32_t>(buttons[i] != 0) << i;
+  }
+  pimpl_->push(sample);
+}
+
+void Recorder::recordOutput(int64_t stamp_ns, const double* values)
+{
+  RawSample sample;
+  sample.stamp_ns = stamp_ns;
+  sample.stream = STREAM_OUTPUT;
+  sample.num_values = 6;
+  sample.num_buttons = 0;
+  sample.buttons = 0;
+  for (size_t i = 0; i < 6; ++i)
+  {
+    sample.values[i] = static_cast<float>(values[i]);
+  }
+  pimpl_->push(sample);
+}
+
+uint64_t Recorder::dropped() const
+{
+  return pimpl_->dropped.load(std::memory_order_relaxed);
+}
+
+bool decodeRecording(const std::string& path, const std::function<void(const RecordedSample&)>& sink,
+                     std::string& error)
+{
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    error = "cannot open " + path;
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[65536];
+  for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+  {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  std::fclose(file);
+
+  double quantization[NUM_STREAMS];
+  uint32_t fields[2];
+  const size_t header_size = sizeof(kRecordMagic) + sizeof(fields) + sizeof(quantization);
+  if (data.size() < header_size || std::memcmp(data.data(), kRecordMagic, sizeof(kRecordMagic)) != 0)
+  {
+    error = path + " is not a teleop recording";
+    return false;
+  }
+  std::memcpy(fields, &data[sizeof(kRecordMagic)], sizeof(fields));
+  std::memcpy(quantization, &data[sizeof(kRecordMagic) + sizeof(fields)], sizeof(quantization));
+  if (fields[0] != kRecordVersion)
+  {
+    error = path + " is not a version " + std::to_string(kRecordVersion) + " recording";
+    return false;
+  }
+
+  const uint8_t* p = data.data() + header_size;
+  const uint8_t* const file_end = data.data() + data.size();
+  std::vector<RecordedSample> samples;
+  while (file_end - p >= 4)
+  {
+    uint32_t length;
+    std::memcpy(&length, p, sizeof(length));
+    p += sizeof(length);
+    if (static_cast<size_t>(file_end - p) < length)
+    {
+      // The last block of a segment that was being written when the node stopped.
+      error = path + " ends in a truncated block";
+      return false;
+    }
+    const uint8_t* const end = p + length;
+
+    uint64_t stream, count, num_values, num_buttons, v;
+    if (!getVarint(p, end, stream) || !getVarint(p, end, count) || !getVarint(p, end, num_values) ||
+        !getVarint(p, end, num_buttons) || stream >= NUM_STREAMS || num_values > RECORD_MAX_AXES ||
+        num_buttons > RECORD_MAX_BUTTONS || count > length)
+    {
+      error = path + " has a corrupt block header";
+      return false;
+    }
+    samples.assign(count, RecordedSample());
+    int64_t stamp = 0;
+    for (RecordedSample& sample : samples)
+    {
+      sample.stream = static_cast<int>(stream);
+      sample.values.resize(num_values);
+      sample.buttons.resize(num_buttons);
+      if (!getVarint(p, end, v))
+      {
+        error = path + " has a corrupt stamp column";
+        return false;
+      }
+      stamp += unzigzag(v);
+      sample.stamp_ns = stamp;
+    }
+    for (uint64_t column = 0; column < num_values; ++column)
+    {
+      int64_t q = 0;
+      for (RecordedSample& sample : samples)
+      {
+        if (!getVarint(p, end, v))
+        {
+          error = path + " has a corrupt value column";
+          return false;
+        }
+        q += unzigzag(v);
+        sample.values[column] = q / quantization[stream];
+      }
+    }
+    for (uint64_t column = 0; column < num_buttons; ++column)
+    {
+      uint64_t state, run;
+      size_t i = 0;
+      if (!getVarint(p, end, state))
+      {
+        error = path + " has a corrupt button column";
+        return false;
+      }
+      while (i < count)
+      {
+        if (!getVarint(p, end, run) || run == 0 || run > count - i)
+        {
+          error = path + " has a corrupt button column";
+          return false;
+        }
+        for (; run > 0; --run, ++i)
+        {
+          samples[i].buttons[column] = static_cast<int32_t>(state & 1);
+        }
+        state ^= 1;
+      }
+    }
+    for (const RecordedSample& sample : samples)
+    {
+      sink(sample);
+    }
+    p = end;
+  }
+  return true;
+}
+
+}  // namespace teleop_twist_joy
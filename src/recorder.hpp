@@ -0,0 +1,93 @@
+/**
+Software License Agreement (BSD)
+
+\file      recorder.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_RECORDER_H
+#define TELEOP_TWIST_JOY_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace teleop_twist_joy
+{
+
+enum RecordStream
+{
+  STREAM_INPUT = 0,   // Joy axes and buttons as received
+  STREAM_OUTPUT,      // cmd_vel: linear x y z, angular x y z
+  NUM_STREAMS
+};
+
+enum { RECORD_MAX_AXES = 16, RECORD_MAX_BUTTONS = 32 };
+
+struct RecordedSample
+{
+  int stream;
+  int64_t stamp_ns;
+  std::vector<double> values;
+  std::vector<int32_t> buttons;
+};
+
+/**
+ * Always-on recorder of the teleop input and output streams. The record calls only copy the
+ * sample onto a wait-free ring; a background thread gathers samples into blocks of columns and
+ * writes them to rotating <prefix>.<seq>.ttjr segments.
+ *
+ * Each column of a block is stored compactly: stamps and values as zigzag varint deltas, values
+ * quantized to the resolution of a joystick driver (inputs) or 1e-4 (outputs), and each button
+ * as run lengths. Only one thread may record.
+ */
+class Recorder
+{
+public:
+  Recorder(const std::string& prefix, uint64_t max_file_size, uint32_t max_files);
+  ~Recorder();
+
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  void recordInput(int64_t stamp_ns, const float* axes, size_t num_axes, const int32_t* buttons, size_t num_buttons);
+  void recordOutput(int64_t stamp_ns, const double* values);
+
+  /**
+   * Samples lost to a full ring so far.
+   */
+  uint64_t dropped() const;
+
+private:
+  struct Impl;
+  Impl* pimpl_;
+};
+
+/**
+ * Calls sink for every sample of a segment, block by block; each stream is in stamp order.
+ */
+bool decodeRecording(const std::string& path, const std::function<void(const RecordedSample&)>& sink,
+                     std::string& error);
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_RECORDER_H
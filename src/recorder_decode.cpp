@@ -0,0 +1,70 @@
+/**
+Software License Agreement (BSD)
+
+\file      recorder_decode.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+#include "recorder.hpp"
+
+namespace
+{
+
+void printSample(const teleop_twist_joy::RecordedSample& sample)
+{
+  std::printf("%s,%" PRId64 ".%09" PRId64, sample.stream == teleop_twist_joy::STREAM_INPUT ? "joy" : "cmd_vel",
+    sample.stamp_ns / 1000000000, sample.stamp_ns % 1000000000);
+  for (double value : sample.values)
+  {
+    std::printf(",%.6g", value);
+  }
+  for (int32_t button : sample.buttons)
+  {
+    std::printf(",%d", button);
+  }
+  std::printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::fprintf(stderr, "usage: recorder_decode segment.ttjr...\n");
+    return 2;
+  }
+
+  bool ok = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string error;
+    if (!teleop_twist_joy::decodeRecording(argv[i], printSample, error))
+    {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
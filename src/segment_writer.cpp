@@ -0,0 +1,195 @@
+/**
+Software License Agreement (BSD)
+
+\file      segment_writer.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "segment_writer.hpp"
+
+namespace teleop_twist_joy
+{
+
+namespace
+{
+const std::chrono::milliseconds kMinBackoff(100);
+const std::chrono::milliseconds kMaxBackoff(10000);
+}  // namespace
+
+SegmentWriter::SegmentWriter(const std::string& prefix, const std::string& extension, const std::string& header,
+                             uint64_t max_file_size, uint32_t max_files)
+  : prefix_(prefix), extension_(extension), header_(header), max_file_size_(max_file_size),
+    max_files_(std::max<uint32_t>(max_files, 1)), file_(nullptr), file_size_(0), flushed_size_(0),
+    next_seq_(0), backoff_(0), retry_time_()
+{
+  // Continue numbering after any segments a previous run left, rather than overwriting them.
+  const size_t slash = prefix.rfind('/');
+  const std::string dir = slash == std::string::npos ? "." : prefix.substr(0, slash + 1);
+  const std::string base = slash == std::string::npos ? prefix : prefix.substr(slash + 1);
+  if (DIR* d = opendir(dir.c_str()))
+  {
+    while (dirent* entry = readdir(d))
+    {
+      const std::string file_name = entry->d_name;
+      if (file_name.size() > base.size() + 1 + extension.size() &&
+          file_name.compare(0, base.size() + 1, base + ".") == 0 &&
+          file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0)
+      {
+        const std::string digits =
+          file_name.substr(base.size() + 1, file_name.size() - base.size() - 1 - extension.size());
+        char* end = nullptr;
+        const uint64_t seq = std::strtoull(digits.c_str(), &end, 10);
+        if (!digits.empty() && *end == '\0')
+        {
+          next_seq_ = std::max(next_seq_, seq + 1);
+        }
+      }
+    }
+    closedir(d);
+  }
+}
+
+SegmentWriter::~SegmentWriter()
+{
+  if (file_)
+  {
+    closeSegment(false);
+  }
+}
+
+void SegmentWriter::write(const void* data, size_t size)
+{
+  // A unit larger than a whole segment still gets one of its own.
+  if (!file_ || (file_size_ + size > max_file_size_ && file_size_ > header_.size()))
+  {
+    openSegment();
+  }
+  if (!file_)
+  {
+    return;
+  }
+  if (std::fwrite(data, 1, size, file_) == size)
+  {
+    file_size_ += size;
+  }
+  else
+  {
+    closeSegment(true);
+    backOff();
+  }
+}
+
+void SegmentWriter::flush()
+{
+  if (!file_)
+  {
+    return;
+  }
+  if (std::fflush(file_) == 0)
+  {
+    flushed_size_ = file_size_;
+  }
+  else
+  {
+    closeSegment(true);
+    backOff();
+  }
+}
+
+void SegmentWriter::openSegment()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (now < retry_time_)
+  {
+    return;
+  }
+
+  // A failed attempt uses up no sequence number and deletes nothing, so a directory that stays
+  // unwritable cannot eat the segments already there.
+  const uint64_t seq = next_seq_;
+  const std::string path = segmentPath(seq);
+  FILE* file = std::fopen(path.c_str(), "wb");
+  // The header is flushed straight away: a buffered write would succeed on a full disk too.
+  if (!file || std::fwrite(header_.data(), 1, header_.size(), file) != header_.size() ||
+      std::fflush(file) != 0)
+  {
+    if (file)
+    {
+      std::fclose(file);
+      std::remove(path.c_str());
+    }
+    backOff();
+    return;
+  }
+  backoff_ = std::chrono::milliseconds(0);
+
+  if (file_)
+  {
+    closeSegment(false);
+  }
+  file_ = file;
+  file_path_ = path;
+  file_size_ = header_.size();
+  flushed_size_ = file_size_;
+  ++next_seq_;
+  if (seq >= max_files_)
+  {
+    std::remove(segmentPath(seq - max_files_).c_str());
+  }
+}
+
+void SegmentWriter::closeSegment(bool failed)
+{
+  // Once a write or flush has failed, only what the last good flush wrote is known to be whole:
+  // the stream may have passed on any part of its buffer and then dropped the rest, so a later
+  // flush reporting success proves nothing.
+  const bool whole = !failed && std::fflush(file_) == 0;
+  std::fclose(file_);
+  file_ = nullptr;
+  if (!whole)
+  {
+    if (truncate(file_path_.c_str(), static_cast<off_t>(flushed_size_)) != 0)
+    {
+      // Better no segment than one the decoders would misread from the cut onwards.
+      std::remove(file_path_.c_str());
+    }
+  }
+}
+
+void SegmentWriter::backOff()
+{
+  backoff_ = std::min(std::max(2 * backoff_, kMinBackoff), kMaxBackoff);
+  retry_time_ = std::chrono::steady_clock::now() + backoff_;
+}
+
+std::string SegmentWriter::segmentPath(uint64_t seq) const
+{
+  return prefix_ + "." + std::to_string(seq) + extension_;
+}
+
+}  // namespace teleop_twist_joy
@@ -0,0 +1,89 @@
+/**
+Software License Agreement (BSD)
+
+\file      segment_writer.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_SEGMENT_WRITER_H
+#define TELEOP_TWIST_JOY_SEGMENT_WRITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Appends to size-limited segment files <prefix>.<seq><extension>, each starting with the given
+ * header, and deletes the oldest once more than max_files exist. Numbering continues after any
+ * segments a previous run left. Not thread-safe; meant for one background writer thread.
+ *
+ * The oldest segment is only deleted once its replacement has been created. When a segment cannot
+ * be created, opening is retried with a growing backoff; meanwhile units go on being appended to
+ * the current segment past its size limit, or are dropped if there is none.
+ *
+ * A segment only ever holds whole units. When a write or flush fails, e.g. on a full disk, the
+ * segment is closed and cut back to the last unit known to be complete, and the next unit starts
+ * a new segment once the backoff allows.
+ */
+class SegmentWriter
+{
+public:
+  SegmentWriter(const std::string& prefix, const std::string& extension, const std::string& header,
+                uint64_t max_file_size, uint32_t max_files);
+  ~SegmentWriter();
+
+  SegmentWriter(const SegmentWriter&) = delete;
+  SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+  /**
+   * Writes one unit, starting a new segment first if it would not fit; a unit is never split.
+   */
+  void write(const void* data, size_t size);
+  void flush();
+
+private:
+  void openSegment();
+  void closeSegment(bool failed);
+  void backOff();
+  std::string segmentPath(uint64_t seq) const;
+
+  std::string prefix_;
+  std::string extension_;
+  std::string header_;
+  uint64_t max_file_size_;
+  uint32_t max_files_;
+  FILE* file_;
+  std::string file_path_;
+  uint64_t file_size_;
+  // Bytes of the current segment known to have reached the file, always a unit boundary.
+  uint64_t flushed_size_;
+  uint64_t next_seq_;
+  std::chrono::milliseconds backoff_;
+  std::chrono::steady_clock::time_point retry_time_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_SEGMENT_WRITER_H
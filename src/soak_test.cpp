@@ -0,0 +1,334 @@
+/**
+Software License Agreement (BSD)
+
+\file      soak_test.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Soak harness: drives an in-process TeleopTwistJoy under simulated time as fast as it will go,
+ * with random mode, button and parameter churn, and reports memory, latency and correctness at
+ * regular intervals of simulated time.
+ *
+ *   soak_test [--duration s] [--rate hz] [--sample-period s] [--churn-period s] [--seed n] [--report file]
+ *
+ * --duration and the periods are in simulated seconds; --rate is the simulated Joy rate. Exits
+ * with 1 if any command was missing or wrong. ROS arguments are not accepted.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <geometry_msgs/msg/twist.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <rosgraph_msgs/msg/clock.hpp>
+#include <sensor_msgs/msg/joy.hpp>
+
+#include "teleop_twist_joy/teleop_twist_joy.hpp"
+
+namespace
+{
+
+struct Options
+{
+  double duration = 4.0 * 3600.0;
+  double rate = 200.0;
+  double sample_period = 60.0;
+  double churn_period = 5.0;
+  unsigned seed = 1;
+  std::string report = "soak_report.csv";
+};
+
+bool parseOptions(int argc, char *argv[], Options& options)
+{
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const std::string key = argv[i];
+    const char *value = argv[i + 1];
+    if (key == "--duration")
+    {
+      options.duration = std::atof(value);
+    }
+    else if (key == "--rate")
+    {
+      options.rate = std::atof(value);
+    }
+    else if (key == "--sample-period")
+    {
+      options.sample_period = std::atof(value);
+    }
+    else if (key == "--churn-period")
+    {
+      options.churn_period = std::atof(value);
+    }
+    else if (key == "--seed")
+    {
+      options.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+    }
+    else if (key == "--report")
+    {
+      options.report = value;
+    }
+    else
+    {
+      std::fprintf(stderr, "Unknown option %s\n", key.c_str());
+      return false;
+    }
+  }
+  return options.rate > 0.0 && options.duration > 0.0 && options.sample_period > 0.0;
+}
+
+size_t residentKb()
+{
+  // Second field of statm is the resident set, in pages.
+  FILE *file = std::fopen("/proc/self/statm", "r");
+  if (!file)
+  {
+    return 0;
+  }
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  const int fields = std::fscanf(file, "%lu %lu", &size, &resident);
+  std::fclose(file);
+  return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : 0;
+}
+
+size_t heapKb()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks / 1024;
+#elif defined(__GLIBC__)
+  return static_cast<size_t>(mallinfo().uordblks) / 1024;
+#else
+  return 0;
+#endif
+}
+
+double percentile(std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+// Mapping under test; everything else keeps the node defaults.
+const int kLinearAxis = 1;
+const int kAngularAxis = 0;
+const int kEnableButton = 0;
+const int kTurboButton = 1;
+const int kNumAxes = 6;
+const int kNumButtons = 8;
+
+enum Mode { DISABLED, NORMAL, TURBO };
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr, "usage: soak_test [--duration s] [--rate hz] [--sample-period s] "
+                         "[--churn-period s] [--seed n] [--report file]\n");
+    return 2;
+  }
+
+  rclcpp::init(argc, argv);
+
+  auto teleop = std::make_shared<teleop_twist_joy::TeleopTwistJoy>(rclcpp::NodeOptions().parameter_overrides({
+    rclcpp::Parameter("use_sim_time", true),
+    rclcpp::Parameter("axis_linear.x", static_cast<int64_t>(kLinearAxis)),
+    rclcpp::Parameter("axis_angular.yaw", static_cast<int64_t>(kAngularAxis)),
+    rclcpp::Parameter("enable_button", static_cast<int64_t>(kEnableButton)),
+    rclcpp::Parameter("enable_turbo_button", static_cast<int64_t>(kTurboButton)),
+  }));
+  auto driver = std::make_shared<rclcpp::Node>("soak_driver");
+
+  geometry_msgs::msg::Twist received;
+  bool got_cmd_vel = false;
+  auto clock_pub = driver->create_publisher<rosgraph_msgs::msg::Clock>("/clock", 10);
+  auto joy_pub = driver->create_publisher<sensor_msgs::msg::Joy>("joy", 10);
+  auto cmd_vel_sub = driver->create_subscription<geometry_msgs::msg::Twist>("cmd_vel", 10,
+    [&received, &got_cmd_vel](const geometry_msgs::msg::Twist::SharedPtr msg)
+    {
+      received = *msg;
+      got_cmd_vel = true;
+    });
+
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(teleop);
+  executor.add_node(driver);
+
+  FILE *report = std::fopen(options.report.c_str(), "w");
+  if (!report)
+  {
+    std::fprintf(stderr, "Could not open %s\n", options.report.c_str());
+    rclcpp::shutdown();
+    return 2;
+  }
+  std::fprintf(report, "sim_time,wall_time,messages,rss_kb,heap_kb,latency_p50_us,latency_p99_us,"
+                       "latency_max_us,missing,mismatched,parameter_changes\n");
+
+  std::mt19937 rng(options.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_real_distribution<float> stick(-1.0f, 1.0f);
+  std::uniform_real_distribution<double> new_scale(0.1, 2.0);
+
+  // Expected scales, kept in step with the parameters set below; the node defaults to start.
+  double scale[3][2] = {{0.0, 0.0}, {0.5, 0.5}, {1.0, 1.0}};
+  static const char *scale_params[3][2] = {
+    {nullptr, nullptr},
+    {"scale_linear.x", "scale_angular.yaw"},
+    {"scale_linear_turbo.x", "scale_angular_turbo.yaw"}};
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  const int64_t step_ns = static_cast<int64_t>(1e9 / options.rate);
+  const int64_t end_ns = static_cast<int64_t>(options.duration * 1e9);
+  const int64_t sample_ns = static_cast<int64_t>(options.sample_period * 1e9);
+  int64_t next_sample_ns = sample_ns;
+
+  auto joy = std::make_shared<sensor_msgs::msg::Joy>();
+  joy->axes.resize(kNumAxes, 0.0f);
+  joy->buttons.resize(kNumButtons, 0);
+  Mode mode = DISABLED;
+  Mode previous_mode = DISABLED;
+  uint64_t messages = 0;
+  uint64_t missing = 0;
+  uint64_t mismatched = 0;
+  uint64_t parameter_changes = 0;
+  std::vector<double> latencies;
+  latencies.reserve(static_cast<size_t>(options.rate * options.sample_period) + 1);
+  size_t first_rss = 0;
+  size_t last_rss = 0;
+  double first_p99 = -1.0;
+  double last_p99 = 0.0;
+
+  for (int64_t sim_ns = step_ns; sim_ns <= end_ns && rclcpp::ok(); sim_ns += step_ns)
+  {
+    rosgraph_msgs::msg::Clock clock_msg;
+    clock_msg.clock.sec = static_cast<int32_t>(sim_ns / 1000000000);
+    clock_msg.clock.nanosec = static_cast<uint32_t>(sim_ns % 1000000000);
+    clock_pub->publish(clock_msg);
+
+    // Mode churn: on average a change every half second.
+    if (unit(rng) < 2.0 / options.rate)
+    {
+      mode = static_cast<Mode>(rng() % 3);
+    }
+    joy->buttons.assign(kNumButtons, 0);
+    joy->buttons[kEnableButton] = mode == NORMAL;
+    joy->buttons[kTurboButton] = mode == TURBO;
+    for (int button = kTurboButton + 1; button < kNumButtons; ++button)
+    {
+      joy->buttons[button] = unit(rng) < 0.05;
+    }
+    for (float& axis : joy->axes)
+    {
+      axis = stick(rng);
+    }
+
+    // Parameter churn through the same path as ros2 param set.
+    if (options.churn_period > 0.0 && unit(rng) < 1.0 / (options.churn_period * options.rate))
+    {
+      const int which = 1 + rng() % 2;
+      const int field = rng() % 2;
+      const double value = new_scale(rng);
+      teleop->set_parameters({rclcpp::Parameter(scale_params[which][field], value)});
+      scale[which][field] = value;
+      ++parameter_changes;
+    }
+
+    // A command is expected while enabled, and a single stop when enable is released.
+    const bool expect = mode != DISABLED || previous_mode != DISABLED;
+    got_cmd_vel = false;
+    const auto sent = std::chrono::steady_clock::now();
+    joy->header.stamp = clock_msg.clock;
+    joy_pub->publish(*joy);
+    ++messages;
+
+    const auto deadline = sent + std::chrono::milliseconds(100);
+    do
+    {
+      executor.spin_some();
+    }
+    while (expect && !got_cmd_vel && std::chrono::steady_clock::now() < deadline);
+
+    if (expect && !got_cmd_vel)
+    {
+      ++missing;
+    }
+    else if (got_cmd_vel)
+    {
+      latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+      const double linear = mode == DISABLED ? 0.0 : joy->axes[kLinearAxis] * scale[mode][0];
+      const double angular = mode == DISABLED ? 0.0 : joy->axes[kAngularAxis] * scale[mode][1];
+      // The node computes in single precision.
+      if (std::abs(received.linear.x - linear) > 1e-4 || std::abs(received.angular.z - angular) > 1e-4)
+      {
+        ++mismatched;
+      }
+    }
+    previous_mode = mode;
+
+    if (sim_ns >= next_sample_ns || sim_ns + step_ns > end_ns)
+    {
+      next_sample_ns += sample_ns;
+      std::sort(latencies.begin(), latencies.end());
+      const double p99 = percentile(latencies, 0.99);
+      const size_t rss = residentKb();
+      if (first_p99 < 0.0)
+      {
+        first_rss = rss;
+        first_p99 = p99;
+      }
+      last_rss = rss;
+      last_p99 = p99;
+      std::fprintf(report, "%.3f,%.3f,%" PRIu64 ",%zu,%zu,%.1f,%.1f,%.1f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+        sim_ns * 1e-9, std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count(),
+        messages, rss, heapKb(), percentile(latencies, 0.5), p99, latencies.empty() ? 0.0 : latencies.back(),
+        missing, mismatched, parameter_changes);
+      std::fflush(report);
+      latencies.clear();
+    }
+  }
+  std::fclose(report);
+
+  std::printf("%" PRIu64 " messages, %" PRIu64 " missing, %" PRIu64 " mismatched, %" PRIu64 " parameter changes\n",
+    messages, missing, mismatched, parameter_changes);
+  std::printf("RSS %zu -> %zu kB, p99 latency %.1f -> %.1f us, report in %s\n",
+    first_rss, last_rss, first_p99, last_p99, options.report.c_str());
+
+  rclcpp::shutdown();
+  return missing == 0 && mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/**
+Software License Agreement (BSD)
+
+\file      socket_input.cpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_input.hpp"
+
+namespace teleop_twist_joy
+{
+
+SocketInput::SocketInput() : fd_(-1), running_(false), received_(0), invalid_(0)
+{
+}
+
+SocketInput::~SocketInput()
+{
+  running_ = false;
+  if (fd_ >= 0)
+  {
+    shutdown(fd_, SHUT_RDWR);
+  }
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (fd_ >= 0)
+  {
+    close(fd_);
+  }
+  if (!unix_path_.empty())
+  {
+    unlink(unix_path_.c_str());
+  }
+}
+
+bool SocketInput::start(const std::string& endpoint, std::function<void()> on_frame, std::string& error)
+{
+  if (endpoint.compare(0, 5, "unix:") == 0)
+  {
+    unix_path_ = endpoint.substr(5);
+    sockaddr_un addr{};
+    if (unix_path_.empty() || unix_path_.size() >= sizeof(addr.sun_path))
+    {
+      error = "invalid socket path '" + unix_path_ + "'";
+      unix_path_.clear();
+      return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, unix_path_.c_str(), sizeof(addr.sun_path) - 1);
+    // A socket file left behind by a previous run would make bind fail. Anything else at that
+    // path is the user's and is left alone.
+    struct stat existing;
+    if (lstat(unix_path_.c_str(), &existing) == 0)
+    {
+      if (!S_ISSOCK(existing.st_mode))
+      {
+        error = "'" + unix_path_ + "' exists and is not a socket";
+        unix_path_.clear();
+        return false;
+      }
+      unlink(unix_path_.c_str());
+    }
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd_ < 0 || bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      error = "cannot bind " + endpoint + ": " + std::strerror(errno);
+      unix_path_.clear();
+      return false;
+    }
+  }
+  else if (endpoint.compare(0, 4, "udp:") == 0)
+  {
+    const std::string port = endpoint.substr(4);
+    char* end = nullptr;
+    errno = 0;
+    const long number = std::strtol(port.c_str(), &end, 10);
+    if (port.empty() || *end != '\0' || errno != 0 || number < 1 || number > 65535)
+    {
+      error = "invalid UDP port '" + port + "'";
+      return false;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(number));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0 || bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      error = "cannot bind " + endpoint + ": " + std::strerror(errno);
+      return false;
+    }
+  }
+  else
+  {
+    error = "endpoint must be 'unix:<path>' or 'udp:<port>', got '" + endpoint + "'";
+    return false;
+  }
+
+  // Wake up periodically so the destructor never waits on a silent console.
+  timeval timeout{};
+  timeout.tv_usec = 100000;
+  setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  on_frame_ = std::move(on_frame);
+  running_ = true;
+  thread_ = std::thread(&SocketInput::run, this);
+  return true;
+}
+
+bool SocketInput::poll(SocketFrame& frame)
+{
+  if (!slot_.fresh())
+  {
+    return false;
+  }
+  frame = slot_.read();
+  return true;
+}
+
+void SocketInput::run()
+{
+  // One byte larger than a frame, so oversized datagrams are detected instead of truncated.
+  unsigned char buffer[sizeof(SocketFrame) + 1];
+  while (running_)
+  {
+    const ssize_t size = recv(fd_, buffer, sizeof(buffer), 0);
+    if (size < 0)
+    {
+      continue;
+    }
+
+    SocketFrame frame;
+    if (size != static_cast<ssize_t>(sizeof(SocketFrame)))
+    {
+      ++invalid_;
+      continue;
+    }
+    std::memcpy(&frame, buffer, sizeof(frame));
+    if (frame.magic != SocketFrame::kMagic || frame.num_axes > SocketFrame::kMaxAxes ||
+        frame.num_buttons > SocketFrame::kMaxButtons)
+    {
+      ++invalid_;
+      continue;
+    }
+    ++received_;
+    slot_.write(frame);
+    if (on_frame_)
+    {
+      on_frame_();
+    }
+  }
+}
+
+}  // namespace teleop_twist_joy
@@ -0,0 +1,99 @@
+/**
+Software License Agreement (BSD)
+
+\file      socket_input.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_SOCKET_INPUT_H
+#define TELEOP_TWIST_JOY_SOCKET_INPUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "latest_slot.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Fixed binary frame sent by non-ROS operator consoles, little-endian and packed.
+ */
+struct SocketFrame
+{
+  static constexpr uint32_t kMagic = 0x314a5454;  // "TTJ1"
+  static constexpr int kMaxAxes = 16;
+  static constexpr int kMaxButtons = 32;
+
+  uint32_t magic;
+  uint32_t sequence;
+  int64_t stamp_ns;
+  uint8_t num_axes;
+  uint8_t num_buttons;
+  uint16_t reserved;
+  float axes[kMaxAxes];
+  uint32_t buttons;  // Bit i is button i.
+};
+static_assert(sizeof(SocketFrame) == 88, "SocketFrame must match the wire format");
+
+/**
+ * Receives SocketFrames from a UNIX or localhost UDP datagram socket on its own thread and keeps
+ * the latest valid one in a wait-free slot for the executor side to pick up. on_frame is called
+ * from the receive thread after each valid frame, to wake the executor side.
+ */
+class SocketInput
+{
+public:
+  SocketInput();
+  ~SocketInput();
+
+  /**
+   * Binds "unix:<path>" or "udp:<port>" (127.0.0.1 only) and starts the receive thread.
+   * Returns false with a reason in error if the endpoint could not be opened.
+   */
+  bool start(const std::string& endpoint, std::function<void()> on_frame, std::string& error);
+
+  /**
+   * Executor side: the latest frame, if one arrived since the last call.
+   */
+  bool poll(SocketFrame& frame);
+
+  uint64_t received() const { return received_.load(std::memory_order_relaxed); }
+  uint64_t invalid() const { return invalid_.load(std::memory_order_relaxed); }
+
+private:
+  void run();
+
+  int fd_;
+  std::string unix_path_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+  std::function<void()> on_frame_;
+  LatestSlot<SocketFrame> slot_;
+  std::atomic<uint64_t> received_;
+  std::atomic<uint64_t> invalid_;
+};
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_SOCKET_INPUT_H
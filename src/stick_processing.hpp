@@ -0,0 +1,108 @@
+/**
+Software License Agreement (BSD)
+
+\file      stick_processing.hpp
+\copyright Copyright (c) 2014, Clearpath Robotics, Inc., All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+   following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+   following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the name of Clearpath Robotics nor the names of its contributors may be used to endorse or promote
+   products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WAR-
+RANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, IN-
+DIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TELEOP_TWIST_JOY_STICK_PROCESSING_H
+#define TELEOP_TWIST_JOY_STICK_PROCESSING_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "compiled_config.hpp"
+
+namespace teleop_twist_joy
+{
+
+/**
+ * Conditions raw Joy axes into out, which ends up the same length as in:
+ *
+ * - every one of the first MAX_AXES axes is mapped through gain * value + offset, e.g. gain -0.5
+ *   and offset 0.5 turn a trigger resting at +1.0 into 0 at rest and 1 fully pressed;
+ * - each stick pair is then snapped onto the nearer axis when within the snap angle of it, given a
+ *   radial deadzone with the remaining range rescaled to [0, 1], and optionally stretched from the
+ *   circle to the square so diagonals reach full speed on both axes.
+ *
+ * Both loops run over fixed-size arrays laid out one array per quantity, with selects instead of
+ * branches, so the compiler can vectorize them.
+ */
+inline void processAxes(const CompiledConfig& cfg, const std::vector<float>& in, std::vector<float>& out)
+{
+  const size_t count = in.size();
+  double axes[MAX_AXES];
+  for (size_t i = 0; i < MAX_AXES; ++i)
+  {
+    const double raw = i < count ? in[i] : 0.0;
+    axes[i] = raw * cfg.axis_gain[i] + cfg.axis_offset[i];
+  }
+
+  double xs[MAX_PAIRS];
+  double ys[MAX_PAIRS];
+  for (int64_t p = 0; p < cfg.num_pairs; ++p)
+  {
+    xs[p] = axes[cfg.pair_x[p]];
+    ys[p] = axes[cfg.pair_y[p]];
+  }
+  for (int64_t p = 0; p < cfg.num_pairs; ++p)
+  {
+    double x = xs[p];
+    double y = ys[p];
+    const double r = std::sqrt(x * x + y * y);
+    const double ax = std::abs(x);
+    const double ay = std::abs(y);
+
+    // Angular snap keeps the magnitude and zeroes the smaller component.
+    const bool snap = std::min(ax, ay) <= cfg.pair_snap[p] * std::max(ax, ay);
+    const double sx = ax >= ay ? std::copysign(r, x) : 0.0;
+    const double sy = ax >= ay ? 0.0 : std::copysign(r, y);
+    x = snap ? sx : x;
+    y = snap ? sy : y;
+
+    // Radial deadzone, rescaled so the edge of the deadzone maps to zero.
+    const double dz = cfg.pair_deadzone[p];
+    const double radial = r > dz ? std::min(1.0, (r - dz) / (1.0 - dz)) / r : 0.0;
+
+    // Circle to square: a point at radius r on the stick's circle goes to the square's edge.
+    const double m = std::max(std::abs(x), std::abs(y));
+    const double square = m > 0.0 ? r / m : 1.0;
+    const double k = radial * (1.0 + cfg.pair_square[p] * (square - 1.0));
+
+    xs[p] = std::max(-1.0, std::min(1.0, x * k));
+    ys[p] = std::max(-1.0, std::min(1.0, y * k));
+  }
+  for (int64_t p = 0; p < cfg.num_pairs; ++p)
+  {
+    axes[cfg.pair_x[p]] = xs[p];
+    axes[cfg.pair_y[p]] = ys[p];
+  }
+
+  out.assign(in.begin(), in.end());
+  for (size_t i = 0; i < count && i < MAX_AXES; ++i)
+  {
+    out[i] = static_cast<float>(axes[i]);
+  }
+}
+
+}  // namespace teleop_twist_joy
+
+#endif  // TELEOP_TWIST_JOY_STICK_PROCESSING_H
@@ -22,23 +22,57 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCL
 ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <diagnostic_msgs/msg/diagnostic_status.hpp>
 #include <geometry_msgs/msg/twist.hpp>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp_components/register_node_macro.hpp>
 #include <rcutils/logging_macros.h>
+#include <sensor_msgs/msg/imu.hpp>
+#include <sensor_msgs/msg/joint_state.hpp>
 #include <sensor_msgs/msg/joy.hpp>
+#include <sensor_msgs/msg/joy_feedback_array.hpp>
+#include <std_msgs/msg/float64_multi_array.hpp>
+#include <std_srvs/srv/trigger.hpp>
 
 #include "teleop_twist_joy/teleop_twist_joy.hpp"
+#include "compiled_config.hpp"
+#include "event_log.hpp"
+#include "guard_waitable.hpp"
+#include "latest_slot.hpp"
+#ifdef TELEOP_TWIST_JOY_FIXED_PROFILE
+#include "fixed_profile.hpp"
+#endif
+#include "macro.hpp"
+#include "pipeline.hpp"
+#include "profile_db.hpp"
+#include "recorder.hpp"
+#include "socket_input.hpp"
+#include "spsc_ring.hpp"
+#include "stick_processing.hpp"
 
 #define ROS_INFO_NAMED RCUTILS_LOG_INFO_NAMED
 #define ROS_INFO_COND_NAMED RCUTILS_LOG_INFO_EXPRESSION_NAMED
+#define ROS_WARN_NAMED RCUTILS_LOG_WARN_NAMED
 
 namespace teleop_twist_joy
 {
@@ -51,28 +85,376 @@ namespace teleop_twist_joy
 struct TeleopTwistJoy::Impl
 {
   void joyCallback(const sensor_msgs::msg::Joy::SharedPtr joy);
-  void sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr, const std::string& which_map);
+  void joyBatchCallback(const std_msgs::msg::Float64MultiArray::SharedPtr batch);
+  void processJoy(const sensor_msgs::msg::Joy::SharedPtr joy, const rclcpp::Time& now);
+  void sourceCallback(size_t source, const sensor_msgs::msg::Joy::SharedPtr joy);
+  void socketCallback();
+  void sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr, int which_scale);
+  void updateLinkFeedback(const sensor_msgs::msg::Joy& joy_msg, const rclcpp::Time& now);
+  void imuCallback(const sensor_msgs::msg::Imu::SharedPtr imu);
+  void applyHeadingHold(geometry_msgs::msg::Twist& cmd_vel, const rclcpp::Time& now);
+  void sendJointJogMsg(const sensor_msgs::msg::Joy& joy_msg, int which_scale);
+  void sendJointStop(const rclcpp::Time& now);
+  void switchOutput(const rclcpp::Time& now);
+  std::vector<rclcpp::Parameter> profileParameters(const CompiledConfig& cfg,
+    const std::vector<std::string>& pipeline) const;
+  void matchProfile(const sensor_msgs::msg::Joy& joy_msg);
+  void applyParameters(const std::vector<rclcpp::Parameter>& parameters);
+  void debounceCallback();
+  void publishCmdVel(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg);
+  bool adaptiveRateAllows(const geometry_msgs::msg::Twist& cmd_vel);
+  void adaptiveRateCallback();
+  void plannerCallback(const geometry_msgs::msg::Twist::SharedPtr planner_msg);
+  double blendWeight(const sensor_msgs::msg::Joy& joy_msg) const;
+  void blendInto(geometry_msgs::msg::Twist& cmd_vel, const rclcpp::Time& now) const;
+  void dropoutCallback();
+  void statsCallback();
+  void updateAnalytics(const sensor_msgs::msg::Joy& joy_msg, int mode, double dt);
+  std::unique_ptr<diagnostic_msgs::msg::DiagnosticStatus> analyticsSnapshot() const;
+  void analyticsCallback();
+  bool mappedAxesCentered(const sensor_msgs::msg::Joy& joy_msg, double deadband) const;
+  void enterIdle();
+  void leaveIdle();
+  bool macroInput(const sensor_msgs::msg::Joy& joy_msg, bool enabled, const rclcpp::Time& now);
+  void finishRecording();
+  void startPlayback();
+  void abortPlayback();
+  void playbackThread();
+  void macroCallback();
+  void publishCommand(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg);
+  void sendToPublisher(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg);
+  void publisherThread();
+  void logEvent(EventType type, uint32_t arg = 0, double value = 0.0);
+  void logRejection(const std::string& name, RejectReason reason);
+
+  // All time-based behaviour follows the node clock, so it honours use_sim_time.
+  rclcpp::Clock::SharedPtr clock;
 
   rclcpp::Subscription<sensor_msgs::msg::Joy>::SharedPtr joy_sub;
+  rclcpp::Subscription<std_msgs::msg::Float64MultiArray>::SharedPtr joy_batch_sub;
+  std::vector<rclcpp::Subscription<sensor_msgs::msg::Joy>::SharedPtr> source_subs;
   rclcpp::Publisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub;
+  rclcpp::Subscription<geometry_msgs::msg::Twist>::SharedPtr planner_sub;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr stats_pub;
+  rclcpp::TimerBase::SharedPtr dropout_timer;
+  rclcpp::TimerBase::SharedPtr stats_timer;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr analytics_pub;
+  rclcpp::TimerBase::SharedPtr analytics_timer;
+  rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr analytics_srv;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr joint_jog_pub;
+  rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr imu_sub;
+  rclcpp::Publisher<sensor_msgs::msg::JoyFeedbackArray>::SharedPtr feedback_pub;
+  rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr fleet_pub;
 
-  bool require_enable_button;
   bool autorun_flag;
-  int64_t enable_button;
-  int64_t enable_turbo_button;
-  int64_t enable_autorun_button;
   int64_t autorun_buffer;
 
-  std::map<std::string, int64_t> axis_linear_map;
-  std::map<std::string, std::map<std::string, double>> scale_linear_map;
+  // Joint jog output for manipulators, selected instead of cmd_vel with joint_jog.toggle_button.
+  // The names go into every message; the axes and scales live in the config.
+  std::vector<std::string> joint_names;
+  int64_t joint_jog_toggle_button;
+  bool joint_jog_toggle_pressed;
+  bool arm_mode;
+  bool sent_joint_stop;
 
-  std::map<std::string, int64_t> axis_angular_map;
-  std::map<std::string, int64_t> axis_angular_adjustment_map;
-  std::map<std::string, std::map<std::string, double>> scale_angular_map;
+  // Raw axis conditioning (per-axis normalization and two-dimensional stick processing) writes here.
+  sensor_msgs::msg::Joy::SharedPtr processed_joy;
+
+  /**
+   * Batched input: rows of [stamp, axes..., buttons...] run through processJoy one by one, on
+   * times spaced as the samples were. With joy_batch.output "last" the outputs of a batch are
+   * held and only the final one is published.
+   */
+  int64_t joy_batch_axes;
+  int64_t joy_batch_buttons;
+  bool joy_batch_last_only;
+  sensor_msgs::msg::Joy::SharedPtr batch_joy;
+  bool batch_holding;
+  std::unique_ptr<geometry_msgs::msg::Twist> held_cmd_vel;
+  std::unique_ptr<sensor_msgs::msg::JointState> held_joint_msg;
+  // Time of the Joy sample being processed; filters and heading hold integrate over it.
+  rclcpp::Time input_time;
+
+  /**
+   * The whole mapping: axes, scales, buttons, joint jog tables, axis conditioning and pipeline
+   * stages. It is the only copy an instance keeps, so instances with the same parameters share
+   * all of it. Parameter changes edit a copy and intern that; everything per message reads this.
+   */
+  std::shared_ptr<const CompiledConfig> config;
+
+#if defined(TELEOP_TWIST_JOY_FIXED_PROFILE) && !defined(TELEOP_TWIST_JOY_FIXED_PROFILE_OVERRIDES)
+  // The mapping is a compile-time constant, so axis indices and scales fold into the per-message code.
+  const CompiledConfig& activeConfig() const { return kFixedProfile; }
+#else
+  const CompiledConfig& activeConfig() const { return *config; }
+#endif
+
+  /**
+   * Profile database, consulted once on the first Joy message and then released.
+   */
+  std::unique_ptr<ProfileDb> profile_db;
+  std::string device_name;
+  // Updates the node's parameters to a matched profile, so they report what the node does.
+  std::function<void(const std::vector<rclcpp::Parameter>&)> set_node_parameters;
+  // Set while they are updated: the profile's table is already in use, so the parameter
+  // callback only accepts them instead of building the same table again.
+  bool reporting_profile;
+
+  // Parameter updates staged during parameter_debounce and applied as one batch.
+  double parameter_debounce;
+  std::map<std::string, rclcpp::Parameter> pending_parameters;
+  rclcpp::TimerBase::SharedPtr debounce_timer;
 
   float_t speed_x_max;
 
+  PipelineState pipeline_state;
+  rclcpp::Time last_pipeline_time;
+#ifndef NDEBUG
+  // Time spent in each pipeline stage, reported on ~/stats.
+  struct StageTimer
+  {
+    uint64_t runs = 0;
+    uint64_t stage_ns[MAX_STAGES] = {};
+    std::chrono::steady_clock::time_point start;
+    void begin() { start = std::chrono::steady_clock::now(); }
+    void end(int64_t stage)
+    {
+      stage_ns[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+  } stage_timer;
+#endif
+
   bool sent_disable_msg;
+
+  // Dropout handling: what to do when Joy messages stop arriving while moving.
+  std::string dropout_policy;
+  double dropout_timeout;
+  double dropout_max_duration;
+  std::string dropout_decay_curve;
+  rclcpp::Time last_joy_time;
+  geometry_msgs::msg::Twist last_cmd_vel;
+  bool in_dropout;
+
+  // Adaptive output rate: publish fast while the command changes, slow keepalives while it is steady.
+  bool adaptive_rate;
+  double adaptive_rate_min;
+  double adaptive_rate_max;
+  double adaptive_rate_low_threshold;
+  double adaptive_rate_high_threshold;
+  double adaptive_target_rate;
+  geometry_msgs::msg::Twist last_mapped_cmd_vel;
+  rclcpp::Time last_mapped_time;
+  rclcpp::Time last_publish_time;
+  // Latest command held back by the rate; sent by adaptive_timer when its slot comes up.
+  std::unique_ptr<geometry_msgs::msg::Twist> pending_cmd_vel;
+  rclcpp::TimerBase::SharedPtr adaptive_timer;
+
+  // Shared autonomy: cmd_vel = w * joystick + (1 - w) * planner.
+  bool blend_mode;
+  int64_t blend_weight_axis;
+  double blend_weight_axis_rest;
+  double blend_weight_axis_full;
+  double blend_joy_timeout;
+  double blend_planner_timeout;
+  double blend_weight;
+  geometry_msgs::msg::Twist joy_cmd_vel;
+  geometry_msgs::msg::Twist planner_cmd_vel;
+  rclcpp::Time last_planner_time;
+
+  // Multi-operator fusion: each output axis and the buttons can come from a different Joy topic.
+  struct JoySample
+  {
+    sensor_msgs::msg::Joy::SharedPtr joy;
+    rclcpp::Time stamp;
+  };
+  // Written and read only by sourceCallback, which runs on the executor like every Joy callback.
+  std::vector<JoySample> source_samples;
+  double joy_source_timeout;
+  int64_t source_field[NUM_FIELDS];
+  int64_t source_buttons;
+  std::vector<const sensor_msgs::msg::Joy*> source_latest;
+  sensor_msgs::msg::Joy::SharedPtr fused_joy;
+
+  // Input backend reading fixed binary frames from a local datagram socket instead of joy. The
+  // receive thread triggers socket_waitable, which runs socketCallback on the executor; declared
+  // first so the thread is stopped before it goes away.
+  std::shared_ptr<GuardWaitable> socket_waitable;
+  std::unique_ptr<SocketInput> socket_input;
+  sensor_msgs::msg::Joy::SharedPtr socket_joy;
+  uint32_t socket_sequence;
+  bool socket_have_sequence;
+
+  /**
+   * Link feedback: input age from the Joy stamps and loss from arrival gaps, both smoothed, and a
+   * rumble on the controller while either is past its threshold.
+   */
+  bool link_feedback;
+  double link_expected_period;
+  double link_age_threshold;
+  double link_loss_threshold;
+  double link_feedback_period;
+  double link_feedback_intensity;
+  double link_input_age;
+  double link_loss;
+  bool link_degraded;
+  rclcpp::Time link_last_arrival;
+  rclcpp::Time link_last_feedback;
+
+  /**
+   * Heading hold: while driving with no turn commanded, a PI loop on the measured yaw rate drives
+   * angular.z so the robot keeps its heading. The IMU callback only writes the two atomics, so it
+   * may run in any callback group.
+   */
+  bool heading_hold;
+  double heading_hold_kp;
+  double heading_hold_ki;
+  double heading_hold_deadband;
+  double heading_hold_max_correction;
+  double heading_hold_imu_timeout;
+  std::atomic<double> imu_yaw_rate;
+  std::atomic<int64_t> imu_stamp_ns;
+  double heading_error;
+  bool heading_holding;
+  rclcpp::Time last_heading_time;
+
+  // Idle mode: after idle_timeout of disabled, centered input only edges are looked for.
+  double idle_timeout;
+  double idle_deadband;
+  bool idle;
+  bool quiet;
+  rclcpp::Time quiet_since;
+  std::vector<int32_t> last_buttons;
+
+  /**
+   * Maneuver macros: the published command stream is recorded with timestamps and replayed by a
+   * dedicated thread. The thread only keeps time: it hands each command to macroCallback on the
+   * executor, which publishes it like any other command.
+   */
+  int64_t macro_record_button;
+  int64_t macro_play_button;
+  double macro_abort_deadband;
+  std::string macro_file;
+  Macro macro;
+  bool macro_recording;
+  rclcpp::Time macro_record_start;
+  bool macro_record_pressed;
+  bool macro_play_pressed;
+  std::thread macro_thread;
+  std::atomic<bool> macro_playing;
+  std::atomic<bool> macro_abort;
+  // Wakes the playback thread for an abort or a change of the node clock.
+  std::mutex macro_mutex;
+  std::condition_variable macro_cv;
+  struct MacroCommand
+  {
+    geometry_msgs::msg::Twist cmd_vel;
+    bool last = false;
+  };
+  LatestSlot<MacroCommand> macro_slot;
+  std::shared_ptr<GuardWaitable> macro_waitable;
+
+  /**
+   * Binary event log of mode changes, toggles, stops and rejections; null when disabled.
+   */
+  std::unique_ptr<EventLog> event_log;
+  int last_mode;
+
+  /**
+   * Columnar recording of the raw Joy input and the cmd_vel output; null when disabled. Fed
+   * only from the executor, which makes it the single producer of the recorder's ring.
+   */
+  std::unique_ptr<Recorder> recorder;
+
+  /**
+   * Publish offload: executor callbacks only queue finished commands, and a dedicated thread
+   * does the serialization and middleware work.
+   *
+   * publish_queue is single-producer: only sendToPublisher pushes, and it must only be reached
+   * from callbacks of the node's default mutually exclusive callback group, so no two threads
+   * ever push at once. Threads of our own (macro playback, socket input) hand their commands to
+   * the executor instead of publishing.
+   *
+   * When the ring is full the newest command waits in publish_overflow, replacing any older one
+   * there, and later commands follow it there until the publish thread has drained the ring and
+   * taken it. The executor never waits, order is kept, and the latest command (a stop included)
+   * always goes out; only commands superseded while the publisher is stalled are dropped.
+   */
+  enum { PUBLISH_QUEUE_CAPACITY = 64 };
+  std::unique_ptr<SpscRing<geometry_msgs::msg::Twist, PUBLISH_QUEUE_CAPACITY>> publish_queue;
+  std::thread publish_thread;
+  std::atomic<bool> publish_stop;
+  std::atomic<bool> publisher_sleeping;
+  std::mutex publish_mutex;
+  std::condition_variable publish_cv;
+  // Guarded by publish_mutex; the flag is also read without it on the executor's fast path.
+  std::unique_ptr<geometry_msgs::msg::Twist> publish_overflow;
+  std::atomic<bool> publish_overflowed;
+  int64_t publish_thread_priority;
+  int64_t publish_thread_cpu;
+
+  /**
+   * Fleet output: each command is also packed into one message of per-robot rows, so fanning
+   * out to many robots costs one publish per tick.
+   */
+  std::vector<int64_t> fleet_robot_ids;
+  std::vector<double> fleet_robot_gains;
+
+  /**
+   * Operator-behaviour analytics. Running aggregates of fixed size, updated with a few arithmetic
+   * operations per Joy message and never storing individual samples.
+   */
+  enum DriveMode { MODE_DISABLED = 0, MODE_NORMAL, MODE_TURBO, MODE_AUTORUN, NUM_MODES };
+  struct Analytics
+  {
+    static constexpr size_t kMaxAxes = 16;
+    static constexpr size_t kBins = 10;
+    uint64_t samples = 0;
+    size_t axes = 0;
+    uint32_t histogram[kMaxAxes][kBins] = {};
+    uint64_t saturated[kMaxAxes] = {};
+    double mode_time[NUM_MODES] = {};
+    uint64_t mode_entries[NUM_MODES] = {};
+    uint64_t autorun_toggles = 0;
+    uint64_t enable_releases = 0;
+    int mode = MODE_DISABLED;
+  } analytics;
+  bool analytics_enabled;
+
+  /**
+   * Counters published on ~/stats. Only touched from executor callbacks.
+   */
+  struct Stats
+  {
+    uint64_t joy_msgs = 0;
+    uint64_t cmd_vel_msgs = 0;
+    uint64_t dropout_activations = 0;
+    uint64_t dropout_stops = 0;
+    double dropout_last_duration = 0.0;
+    double dropout_max_duration = 0.0;
+    double dropout_total_duration = 0.0;
+    uint64_t adaptive_rate_skipped = 0;
+    double cmd_vel_rate = 0.0;
+    uint64_t planner_msgs = 0;
+    std::vector<uint64_t> source_stale;
+    uint64_t wakeups = 0;
+    uint64_t idle_entries = 0;
+    uint64_t last_wakeups = 0;
+    double last_cpu_time = 0.0;
+    rclcpp::Time last_report;
+    uint64_t parameters_staged = 0;
+    uint64_t config_rebuilds = 0;
+    uint64_t socket_out_of_order = 0;
+    uint64_t macro_playbacks = 0;
+    uint64_t macro_aborts = 0;
+    uint64_t heading_hold_corrections = 0;
+    uint64_t link_feedback_msgs = 0;
+    uint64_t heading_hold_stale_imu = 0;
+    uint64_t publish_queue_full = 0;
+    uint64_t publish_queue_superseded = 0;
+    uint64_t joy_batches = 0;
+    uint64_t joy_batch_malformed = 0;
+  } stats;
 };
 
 /**
@@ -81,20 +463,80 @@ struct TeleopTwistJoy::Impl
 TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleop_twist_joy_node", options)
 {
   pimpl_ = new Impl;
+  pimpl_->clock = this->get_clock();
 
   pimpl_->cmd_vel_pub = this->create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 10);
-  pimpl_->joy_sub = this->create_subscription<sensor_msgs::msg::Joy>("joy", rclcpp::QoS(10),
-    std::bind(&TeleopTwistJoy::Impl::joyCallback, this->pimpl_, std::placeholders::_1));
 
-  pimpl_->require_enable_button = this->declare_parameter("require_enable_button", true);
+  // Settings that decide which topics and timers exist only take effect at startup.
+  rcl_interfaces::msg::ParameterDescriptor read_only;
+  read_only.read_only = true;
+
+  std::vector<std::string> joy_sources =
+    this->declare_parameter("joy_sources", std::vector<std::string>(), read_only);
+  std::string socket_input = this->declare_parameter("socket_input", std::string(""), read_only);
+  if (!socket_input.empty())
+  {
+    std::string error;
+    pimpl_->socket_waitable = std::make_shared<GuardWaitable>(this->get_node_base_interface()->get_context(),
+      std::bind(&TeleopTwistJoy::Impl::socketCallback, this->pimpl_));
+    std::shared_ptr<GuardWaitable> waitable = pimpl_->socket_waitable;
+    pimpl_->socket_input.reset(new SocketInput());
+    if (!pimpl_->socket_input->start(socket_input, [waitable]() { waitable->trigger(); }, error))
+    {
+      RCLCPP_ERROR(this->get_logger(), "socket_input: %s, listening on joy instead.", error.c_str());
+      pimpl_->socket_input.reset();
+      pimpl_->socket_waitable.reset();
+    }
+  }
+  if (pimpl_->socket_input)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Reading input frames from %s.", socket_input.c_str());
+    pimpl_->socket_joy = std::make_shared<sensor_msgs::msg::Joy>();
+    pimpl_->socket_have_sequence = false;
+    // Woken by the receive thread, so an idle socket costs no executor wakeups at all.
+    this->get_node_waitables_interface()->add_waitable(pimpl_->socket_waitable, nullptr);
+  }
+  else if (joy_sources.empty())
+  {
+    pimpl_->joy_sub = this->create_subscription<sensor_msgs::msg::Joy>("joy", rclcpp::QoS(10),
+      std::bind(&TeleopTwistJoy::Impl::joyCallback, this->pimpl_, std::placeholders::_1));
+  }
+
+  const bool joy_batch = this->declare_parameter("joy_batch.enabled", false, read_only);
+  pimpl_->joy_batch_axes = this->declare_parameter("joy_batch.axes", 8, read_only);
+  pimpl_->joy_batch_buttons = this->declare_parameter("joy_batch.buttons", 11, read_only);
+  const std::string joy_batch_output = this->declare_parameter("joy_batch.output", std::string("all"), read_only);
+  pimpl_->joy_batch_last_only = joy_batch_output == "last";
+  if (joy_batch_output != "all" && joy_batch_output != "last")
+  {
+    RCLCPP_WARN(this->get_logger(), "Unknown joy_batch.output '%s', using 'all'.", joy_batch_output.c_str());
+  }
+  pimpl_->batch_holding = false;
+  pimpl_->input_time = pimpl_->clock->now();
+  if (joy_batch && (pimpl_->joy_batch_axes < 0 || pimpl_->joy_batch_buttons < 0))
+  {
+    RCLCPP_WARN(this->get_logger(), "joy_batch.axes and joy_batch.buttons must not be negative, ignoring joy_batch.");
+  }
+  else if (joy_batch)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Accepting batches of %" PRId64 " axes and %" PRId64 " buttons on joy_batch.",
+      pimpl_->joy_batch_axes, pimpl_->joy_batch_buttons);
+    pimpl_->batch_joy = std::make_shared<sensor_msgs::msg::Joy>();
+    pimpl_->batch_joy->axes.resize(pimpl_->joy_batch_axes);
+    pimpl_->batch_joy->buttons.resize(pimpl_->joy_batch_buttons);
+    pimpl_->joy_batch_sub = this->create_subscription<std_msgs::msg::Float64MultiArray>("joy_batch",
+      rclcpp::QoS(10), std::bind(&TeleopTwistJoy::Impl::joyBatchCallback, this->pimpl_, std::placeholders::_1));
+  }
+
+  const bool require_enable_button = this->declare_parameter("require_enable_button", true);
 
   pimpl_->autorun_flag = false;
 
-  pimpl_->enable_button = this->declare_parameter("enable_button", 5);
+  const int64_t enable_button = this->declare_parameter("enable_button", 5);
 
-  pimpl_->enable_turbo_button = this->declare_parameter("enable_turbo_button", -1);
+  const int64_t enable_turbo_button = this->declare_parameter("enable_turbo_button", -1);
 
-  pimpl_->enable_autorun_button = this->declare_parameter("enable_autorun_button", -1);
+  const int64_t enable_autorun_button = this->declare_parameter("enable_autorun_button", -1);
 
   pimpl_->autorun_buffer = 0;
 
@@ -104,7 +546,8 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"z", -1L},
   };
   this->declare_parameters("axis_linear", default_linear_map);
-  this->get_parameters("axis_linear", pimpl_->axis_linear_map);
+  std::map<std::string, int64_t> axis_linear_map;
+  this->get_parameters("axis_linear", axis_linear_map);
 
   std::map<std::string, int64_t> default_angular_map{
     {"yaw", 2L},
@@ -112,7 +555,8 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"roll", -1L},
   };
   this->declare_parameters("axis_angular", default_angular_map);
-  this->get_parameters("axis_angular", pimpl_->axis_angular_map);
+  std::map<std::string, int64_t> axis_angular_map;
+  this->get_parameters("axis_angular", axis_angular_map);
 
   std::map<std::string, int64_t> default_angular_adjustment_map{
       {"yaw", 3L},
@@ -120,7 +564,8 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
           {"roll", -1L},
   };
   this->declare_parameters("axis_angular_adjustment", default_angular_adjustment_map);
-  this->get_parameters("axis_angular_adjustment", pimpl_->axis_angular_adjustment_map);
+  std::map<std::string, int64_t> axis_angular_adjustment_map;
+  this->get_parameters("axis_angular_adjustment", axis_angular_adjustment_map);
 
   std::map<std::string, double> default_scale_linear_normal_map{
     {"x", 0.5},
@@ -128,7 +573,8 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"z", 0.0},
   };
   this->declare_parameters("scale_linear", default_scale_linear_normal_map);
-  this->get_parameters("scale_linear", pimpl_->scale_linear_map["normal"]);
+  std::map<std::string, std::map<std::string, double>> scale_linear_map;
+  this->get_parameters("scale_linear", scale_linear_map["normal"]);
 
   std::map<std::string, double> default_scale_linear_turbo_map{
     {"x", 1.0},
@@ -136,7 +582,7 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"z", 0.0},
   };
   this->declare_parameters("scale_linear_turbo", default_scale_linear_turbo_map);
-  this->get_parameters("scale_linear_turbo", pimpl_->scale_linear_map["turbo"]);
+  this->get_parameters("scale_linear_turbo", scale_linear_map["turbo"]);
 
   // autorun scale
   std::map<std::string, double> default_scale_linear_autorun_map{
@@ -145,7 +591,7 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"z", 0.0},
   };
   this->declare_parameters("scale_linear_autorun", default_scale_linear_autorun_map);
-  this->get_parameters("scale_linear_autorun", pimpl_->scale_linear_map["autorun"]);
+  this->get_parameters("scale_linear_autorun", scale_linear_map["autorun"]);
 
   std::map<std::string, double> default_scale_angular_normal_map{
     {"yaw", 0.5},
@@ -153,7 +599,8 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"roll", 0.0},
   };
   this->declare_parameters("scale_angular", default_scale_angular_normal_map);
-  this->get_parameters("scale_angular", pimpl_->scale_angular_map["normal"]);
+  std::map<std::string, std::map<std::string, double>> scale_angular_map;
+  this->get_parameters("scale_angular", scale_angular_map["normal"]);
 
   std::map<std::string, double> default_scale_angular_turbo_map{
     {"yaw", 1.0},
@@ -161,7 +608,7 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"roll", 0.0},
   };
   this->declare_parameters("scale_angular_turbo", default_scale_angular_turbo_map);
-  this->get_parameters("scale_angular_turbo", pimpl_->scale_angular_map["turbo"]);
+  this->get_parameters("scale_angular_turbo", scale_angular_map["turbo"]);
 
   // autorun scale
   std::map<std::string, double> default_scale_angular_autorun_map{
@@ -170,35 +617,499 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     {"roll", 0.0},
   };
   this->declare_parameters("scale_angular_autorun", default_scale_angular_autorun_map);
-  this->get_parameters("scale_angular_autorun", pimpl_->scale_angular_map["autorun"]);
+  this->get_parameters("scale_angular_autorun", scale_angular_map["autorun"]);
 
-  ROS_INFO_COND_NAMED(pimpl_->require_enable_button, "TeleopTwistJoy",
-      "Teleop enable button %" PRId64 ".", pimpl_->enable_button);
-  ROS_INFO_COND_NAMED(pimpl_->enable_turbo_button >= 0, "TeleopTwistJoy",
-    "Turbo on button %" PRId64 ".", pimpl_->enable_turbo_button);
+  ROS_INFO_COND_NAMED(require_enable_button, "TeleopTwistJoy",
+      "Teleop enable button %" PRId64 ".", enable_button);
+  ROS_INFO_COND_NAMED(enable_turbo_button >= 0, "TeleopTwistJoy",
+    "Turbo on button %" PRId64 ".", enable_turbo_button);
 
-  for (std::map<std::string, int64_t>::iterator it = pimpl_->axis_linear_map.begin();
-       it != pimpl_->axis_linear_map.end(); ++it)
+  for (std::map<std::string, int64_t>::iterator it = axis_linear_map.begin();
+       it != axis_linear_map.end(); ++it)
   {
     ROS_INFO_COND_NAMED(it->second != -1L, "TeleopTwistJoy", "Linear axis %s on %" PRId64 " at scale %f.",
-      it->first.c_str(), it->second, pimpl_->scale_linear_map["normal"][it->first]);
-    ROS_INFO_COND_NAMED(pimpl_->enable_turbo_button >= 0 && it->second != -1, "TeleopTwistJoy",
-      "Turbo for linear axis %s is scale %f.", it->first.c_str(), pimpl_->scale_linear_map["turbo"][it->first]);
+      it->first.c_str(), it->second, scale_linear_map["normal"][it->first]);
+    ROS_INFO_COND_NAMED(enable_turbo_button >= 0 && it->second != -1, "TeleopTwistJoy",
+      "Turbo for linear axis %s is scale %f.", it->first.c_str(), scale_linear_map["turbo"][it->first]);
   }
 
-  for (std::map<std::string, int64_t>::iterator it = pimpl_->axis_angular_map.begin();
-       it != pimpl_->axis_angular_map.end(); ++it)
+  for (std::map<std::string, int64_t>::iterator it = axis_angular_map.begin();
+       it != axis_angular_map.end(); ++it)
   {
     ROS_INFO_COND_NAMED(it->second != -1L, "TeleopTwistJoy", "Angular axis %s on %" PRId64 " at scale %f.",
-      it->first.c_str(), it->second, pimpl_->scale_angular_map["normal"][it->first]);
-    ROS_INFO_COND_NAMED(pimpl_->enable_turbo_button >= 0 && it->second != -1, "TeleopTwistJoy",
-      "Turbo for angular axis %s is scale %f.", it->first.c_str(), pimpl_->scale_angular_map["turbo"][it->first]);
+      it->first.c_str(), it->second, scale_angular_map["normal"][it->first]);
+    ROS_INFO_COND_NAMED(enable_turbo_button >= 0 && it->second != -1, "TeleopTwistJoy",
+      "Turbo for angular axis %s is scale %f.", it->first.c_str(), scale_angular_map["turbo"][it->first]);
   }
 
   pimpl_->speed_x_max = 0;
 
   pimpl_->sent_disable_msg = false;
 
+  pimpl_->joint_names = this->declare_parameter("joint_jog.joint_names", std::vector<std::string>(), read_only);
+  std::vector<int64_t> joint_axes = this->declare_parameter("joint_jog.axes", std::vector<int64_t>(), read_only);
+  std::vector<double> joint_scales = this->declare_parameter("joint_jog.scales", std::vector<double>(), read_only);
+  std::vector<double> joint_scales_turbo = this->declare_parameter("joint_jog.scales_turbo", std::vector<double>(), read_only);
+  pimpl_->joint_jog_toggle_button = this->declare_parameter("joint_jog.toggle_button", -1, read_only);
+  pimpl_->joint_jog_toggle_pressed = false;
+  pimpl_->arm_mode = false;
+  pimpl_->sent_joint_stop = true;
+  if (pimpl_->joint_names.size() > MAX_JOINTS)
+  {
+    RCLCPP_WARN(this->get_logger(), "joint_jog supports at most %d joints, ignoring the rest.", MAX_JOINTS);
+    pimpl_->joint_names.resize(MAX_JOINTS);
+  }
+  if (!pimpl_->joint_names.empty())
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Joint jog of %zu joints, toggled with button %" PRId64 ".",
+      pimpl_->joint_names.size(), pimpl_->joint_jog_toggle_button);
+    pimpl_->joint_jog_pub = this->create_publisher<sensor_msgs::msg::JointState>("joint_jog", 10);
+  }
+
+  const std::vector<double> axis_gains = this->declare_parameter("axis_normalization.gain", std::vector<double>(), read_only);
+  const std::vector<double> axis_offsets = this->declare_parameter("axis_normalization.offset", std::vector<double>(), read_only);
+  std::vector<int64_t> stick_pairs = this->declare_parameter("stick_pairs", std::vector<int64_t>(), read_only);
+  double stick_radial_deadzone = this->declare_parameter("stick_radial_deadzone", 0.0, read_only);
+  const bool stick_circle_to_square = this->declare_parameter("stick_circle_to_square", false, read_only);
+  const double stick_snap_angle = this->declare_parameter("stick_snap_angle", 0.0, read_only);
+  pimpl_->processed_joy = std::make_shared<sensor_msgs::msg::Joy>();
+  if (stick_pairs.size() % 2 != 0 || stick_pairs.size() > 2 * MAX_PAIRS ||
+      std::any_of(stick_pairs.begin(), stick_pairs.end(),
+                  [](int64_t axis) { return axis < 0 || axis >= MAX_AXES; }))
+  {
+    RCLCPP_WARN(this->get_logger(), "stick_pairs must list up to %d pairs of axes below %d, ignoring it.",
+      MAX_PAIRS, MAX_AXES);
+    stick_pairs.clear();
+  }
+  if (stick_radial_deadzone < 0.0 || stick_radial_deadzone >= 1.0)
+  {
+    RCLCPP_WARN(this->get_logger(), "stick_radial_deadzone must be in [0, 1), using 0.");
+    stick_radial_deadzone = 0.0;
+  }
+
+  const std::vector<std::string> pipeline = this->declare_parameter("pipeline", std::vector<std::string>());
+
+  // The parameters above are compiled into flat tables here and not kept: parameter updates
+  // edit a copy of the interned table directly.
+  CompiledConfig cfg{};
+  static const char* field_names[NUM_FIELDS] = {"x", "y", "z", "yaw", "pitch", "roll"};
+  static const char* scale_names[NUM_SCALES] = {"normal", "turbo", "autorun"};
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    const bool linear = field < FIELD_ANGULAR_YAW;
+    const std::map<std::string, int64_t>& axis_map = linear ? axis_linear_map : axis_angular_map;
+    auto axis = axis_map.find(field_names[field]);
+    cfg.axis[field] = axis == axis_map.end() ? -1 : axis->second;
+    auto adjustment = axis_angular_adjustment_map.find(field_names[field]);
+    cfg.adjustment_axis[field] = linear || adjustment == axis_angular_adjustment_map.end() ? -1 : adjustment->second;
+    for (int scale = 0; scale < NUM_SCALES; ++scale)
+    {
+      const std::map<std::string, double>& scale_map = (linear ? scale_linear_map : scale_angular_map)[scale_names[scale]];
+      auto value = scale_map.find(field_names[field]);
+      cfg.scale[scale][field] = value == scale_map.end() ? 0.0 : value->second;
+    }
+  }
+  cfg.require_enable_button = require_enable_button;
+  cfg.enable_button = enable_button;
+  cfg.enable_turbo_button = enable_turbo_button;
+  cfg.enable_autorun_button = enable_autorun_button;
+
+  // Joints without an axis entry are unmapped; missing scales default like scale_linear.
+  const std::vector<std::string>& joint_names = pimpl_->joint_names;
+  cfg.num_joints = static_cast<int64_t>(joint_names.size());
+  for (size_t joint = 0; joint < MAX_JOINTS; ++joint)
+  {
+    const bool mapped = joint < joint_names.size() && joint < joint_axes.size();
+    cfg.joint_axis[joint] = mapped ? joint_axes[joint] : -1;
+    cfg.joint_scale[SCALE_NORMAL][joint] = joint < joint_scales.size() ? joint_scales[joint] : 0.5;
+    cfg.joint_scale[SCALE_TURBO][joint] = joint < joint_scales_turbo.size() ? joint_scales_turbo[joint] : 1.0;
+    cfg.joint_scale[SCALE_AUTORUN][joint] = cfg.joint_scale[SCALE_NORMAL][joint];
+  }
+
+  cfg.axis_processing = !stick_pairs.empty();
+  for (size_t i = 0; i < MAX_AXES; ++i)
+  {
+    cfg.axis_gain[i] = i < axis_gains.size() ? axis_gains[i] : 1.0;
+    cfg.axis_offset[i] = i < axis_offsets.size() ? axis_offsets[i] : 0.0;
+    cfg.axis_processing = cfg.axis_processing || cfg.axis_gain[i] != 1.0 || cfg.axis_offset[i] != 0.0;
+  }
+  cfg.num_pairs = static_cast<int64_t>(stick_pairs.size() / 2);
+  const double snap = std::tan(std::min(std::max(stick_snap_angle, 0.0), 45.0) * M_PI / 180.0);
+  for (int64_t p = 0; p < MAX_PAIRS; ++p)
+  {
+    const bool used = p < cfg.num_pairs;
+    cfg.pair_x[p] = used ? stick_pairs[2 * p] : 0;
+    cfg.pair_y[p] = used ? stick_pairs[2 * p + 1] : 0;
+    cfg.pair_deadzone[p] = stick_radial_deadzone;
+    cfg.pair_square[p] = stick_circle_to_square ? 1.0 : 0.0;
+    cfg.pair_snap[p] = stick_snap_angle > 0.0 ? snap : 0.0;
+  }
+
+  std::string pipeline_error;
+  if (!parsePipeline(pipeline, cfg, pipeline_error))
+  {
+    RCLCPP_WARN(this->get_logger(), "Ignoring pipeline: %s.", pipeline_error.c_str());
+  }
+  resetPipeline(pimpl_->pipeline_state);
+  pimpl_->last_pipeline_time = pimpl_->clock->now();
+
+#ifdef TELEOP_TWIST_JOY_FIXED_PROFILE
+  // The profile chosen at build time replaces the mapping from the parameter files; the
+  // parameters are set to match, so they report what the node actually does.
+  ROS_INFO_NAMED("TeleopTwistJoy", "Using the mapping from %s, fixed at build time.", kFixedProfileSource);
+  this->set_parameters(pimpl_->profileParameters(kFixedProfile,
+    std::vector<std::string>(kFixedPipeline, kFixedPipeline + kFixedProfile.num_stages)));
+  cfg = kFixedProfile;
+  pimpl_->joint_names.assign(kFixedJointNames, kFixedJointNames + kFixedProfile.num_joints);
+  if (!pimpl_->joint_names.empty() && !pimpl_->joint_jog_pub)
+  {
+    pimpl_->joint_jog_pub = this->create_publisher<sensor_msgs::msg::JointState>("joint_jog", 10);
+  }
+#endif
+  pimpl_->config = internConfig(cfg);
+
+  std::string profile_database = this->declare_parameter("profile_database", std::string(""), read_only);
+  pimpl_->device_name = this->declare_parameter("device_name", std::string(""), read_only);
+  pimpl_->set_node_parameters = [this](const std::vector<rclcpp::Parameter>& parameters)
+  {
+    this->set_parameters(parameters);
+  };
+  pimpl_->reporting_profile = false;
+#if defined(TELEOP_TWIST_JOY_FIXED_PROFILE) && !defined(TELEOP_TWIST_JOY_FIXED_PROFILE_OVERRIDES)
+  if (!profile_database.empty())
+  {
+    RCLCPP_WARN(this->get_logger(), "The mapping is fixed at build time, ignoring profile_database.");
+    profile_database.clear();
+  }
+#endif
+  if (!profile_database.empty())
+  {
+    std::string error;
+    pimpl_->profile_db.reset(new ProfileDb());
+    if (pimpl_->profile_db->open(profile_database, error))
+    {
+      ROS_INFO_NAMED("TeleopTwistJoy", "Choosing among %zu profiles from %s on the first Joy message.",
+        pimpl_->profile_db->size(), profile_database.c_str());
+    }
+    else
+    {
+      RCLCPP_WARN(this->get_logger(), "Ignoring profile_database: %s.", error.c_str());
+      pimpl_->profile_db.reset();
+    }
+  }
+  pimpl_->parameter_debounce = this->declare_parameter("parameter_debounce", 0.0, read_only);
+  if (pimpl_->parameter_debounce > 0.0)
+  {
+    pimpl_->debounce_timer = rclcpp::create_timer(this, pimpl_->clock,
+      rclcpp::Duration::from_seconds(pimpl_->parameter_debounce),
+      std::bind(&TeleopTwistJoy::Impl::debounceCallback, this->pimpl_));
+    pimpl_->debounce_timer->cancel();
+  }
+
+  if (!joy_sources.empty())
+  {
+    pimpl_->joy_source_timeout = this->declare_parameter("joy_source_timeout", 0.5, read_only);
+    pimpl_->source_buttons = this->declare_parameter("joy_source_buttons", 0, read_only);
+
+    std::map<std::string, int64_t> default_source_linear_map{
+      {"x", 0L},
+      {"y", 0L},
+      {"z", 0L},
+    };
+    std::map<std::string, int64_t> source_linear_map;
+    this->declare_parameters("joy_source_linear", default_source_linear_map);
+    this->get_parameters("joy_source_linear", source_linear_map);
+
+    std::map<std::string, int64_t> default_source_angular_map{
+      {"yaw", 0L},
+      {"pitch", 0L},
+      {"roll", 0L},
+    };
+    std::map<std::string, int64_t> source_angular_map;
+    this->declare_parameters("joy_source_angular", default_source_angular_map);
+    this->get_parameters("joy_source_angular", source_angular_map);
+
+    const int64_t num_sources = static_cast<int64_t>(joy_sources.size());
+    static const char* field_names[NUM_FIELDS] = {"x", "y", "z", "yaw", "pitch", "roll"};
+    for (int field = 0; field < NUM_FIELDS; ++field)
+    {
+      int64_t source = field < FIELD_ANGULAR_YAW ? source_linear_map[field_names[field]] :
+                                                    source_angular_map[field_names[field]];
+      if (source < 0 || source >= num_sources)
+      {
+        RCLCPP_WARN(this->get_logger(), "Joy source %" PRId64 " for %s does not exist, using 0.",
+          source, field_names[field]);
+        source = 0;
+      }
+      pimpl_->source_field[field] = source;
+    }
+    if (pimpl_->source_buttons < 0 || pimpl_->source_buttons >= num_sources)
+    {
+      RCLCPP_WARN(this->get_logger(), "Joy source %" PRId64 " for buttons does not exist, using 0.",
+        pimpl_->source_buttons);
+      pimpl_->source_buttons = 0;
+    }
+
+    pimpl_->source_samples.resize(joy_sources.size());
+    pimpl_->source_latest.resize(joy_sources.size(), nullptr);
+    pimpl_->fused_joy = std::make_shared<sensor_msgs::msg::Joy>();
+    pimpl_->stats.source_stale.resize(joy_sources.size(), 0);
+    for (size_t i = 0; i < joy_sources.size(); ++i)
+    {
+      ROS_INFO_NAMED("TeleopTwistJoy", "Joy source %zu on %s.", i, joy_sources[i].c_str());
+      pimpl_->source_subs.push_back(this->create_subscription<sensor_msgs::msg::Joy>(joy_sources[i], rclcpp::QoS(10),
+        std::bind(&TeleopTwistJoy::Impl::sourceCallback, this->pimpl_, i, std::placeholders::_1)));
+    }
+  }
+
+  pimpl_->dropout_policy = this->declare_parameter("dropout_policy", std::string("none"), read_only);
+  pimpl_->dropout_timeout = this->declare_parameter("dropout_timeout", 0.15, read_only);
+  pimpl_->dropout_max_duration = this->declare_parameter("dropout_max_duration", 0.5, read_only);
+  pimpl_->dropout_decay_curve = this->declare_parameter("dropout_decay_curve", std::string("linear"), read_only);
+  double dropout_check_period = this->declare_parameter("dropout_check_period", 0.02, read_only);
+  pimpl_->in_dropout = false;
+  pimpl_->last_joy_time = pimpl_->clock->now();
+
+  if (pimpl_->dropout_policy != "none" && pimpl_->dropout_policy != "stop" &&
+      pimpl_->dropout_policy != "hold" && pimpl_->dropout_policy != "decay")
+  {
+    RCLCPP_WARN(this->get_logger(), "Unknown dropout_policy '%s', using 'none'.", pimpl_->dropout_policy.c_str());
+    pimpl_->dropout_policy = "none";
+  }
+  if (pimpl_->dropout_decay_curve != "linear" && pimpl_->dropout_decay_curve != "exponential")
+  {
+    RCLCPP_WARN(this->get_logger(), "Unknown dropout_decay_curve '%s', using 'linear'.",
+      pimpl_->dropout_decay_curve.c_str());
+    pimpl_->dropout_decay_curve = "linear";
+  }
+  if (pimpl_->dropout_policy != "none" && dropout_check_period > 0.0)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Dropout policy %s after %f s, stopping after %f s.",
+      pimpl_->dropout_policy.c_str(), pimpl_->dropout_timeout, pimpl_->dropout_max_duration);
+    pimpl_->dropout_timer = rclcpp::create_timer(this, pimpl_->clock,
+      rclcpp::Duration::from_seconds(dropout_check_period),
+      std::bind(&TeleopTwistJoy::Impl::dropoutCallback, this->pimpl_));
+  }
+
+  pimpl_->adaptive_rate = this->declare_parameter("adaptive_rate", false, read_only);
+  pimpl_->adaptive_rate_min = this->declare_parameter("adaptive_rate_min", 2.0, read_only);
+  pimpl_->adaptive_rate_max = this->declare_parameter("adaptive_rate_max", 50.0, read_only);
+  pimpl_->adaptive_rate_low_threshold = this->declare_parameter("adaptive_rate_low_threshold", 0.1, read_only);
+  pimpl_->adaptive_rate_high_threshold = this->declare_parameter("adaptive_rate_high_threshold", 2.0, read_only);
+  pimpl_->adaptive_target_rate = pimpl_->adaptive_rate_max;
+  pimpl_->last_mapped_time = pimpl_->last_joy_time;
+  pimpl_->last_publish_time = pimpl_->last_joy_time;
+  if (pimpl_->adaptive_rate &&
+      (pimpl_->adaptive_rate_min <= 0.0 || pimpl_->adaptive_rate_max < pimpl_->adaptive_rate_min ||
+       pimpl_->adaptive_rate_high_threshold <= pimpl_->adaptive_rate_low_threshold))
+  {
+    RCLCPP_WARN(this->get_logger(), "Invalid adaptive_rate settings, publishing every command.");
+    pimpl_->adaptive_rate = false;
+  }
+  if (pimpl_->adaptive_rate)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Adaptive output rate between %f and %f Hz.",
+      pimpl_->adaptive_rate_min, pimpl_->adaptive_rate_max);
+    pimpl_->adaptive_timer = rclcpp::create_timer(this, pimpl_->clock,
+      rclcpp::Duration::from_seconds(1.0 / pimpl_->adaptive_rate_max),
+      std::bind(&TeleopTwistJoy::Impl::adaptiveRateCallback, this->pimpl_));
+  }
+
+  pimpl_->blend_mode = this->declare_parameter("blend_mode", false, read_only);
+  pimpl_->blend_weight_axis = this->declare_parameter("blend_weight_axis", -1, read_only);
+  pimpl_->blend_weight_axis_rest = this->declare_parameter("blend_weight_axis_rest", 1.0, read_only);
+  pimpl_->blend_weight_axis_full = this->declare_parameter("blend_weight_axis_full", -1.0, read_only);
+  pimpl_->blend_joy_timeout = this->declare_parameter("blend_joy_timeout", 0.5, read_only);
+  pimpl_->blend_planner_timeout = this->declare_parameter("blend_planner_timeout", 0.5, read_only);
+  pimpl_->blend_weight = 0.0;
+  pimpl_->last_planner_time = pimpl_->last_joy_time;
+  if (pimpl_->blend_mode && pimpl_->blend_weight_axis >= 0 &&
+      pimpl_->blend_weight_axis_full == pimpl_->blend_weight_axis_rest)
+  {
+    RCLCPP_WARN(this->get_logger(), "blend_weight_axis_rest equals blend_weight_axis_full, using stick deflection.");
+    pimpl_->blend_weight_axis = -1;
+  }
+  if (pimpl_->blend_mode)
+  {
+    ROS_INFO_COND_NAMED(pimpl_->blend_weight_axis < 0, "TeleopTwistJoy",
+      "Blending with planner_cmd_vel, weighted by stick deflection.");
+    ROS_INFO_COND_NAMED(pimpl_->blend_weight_axis >= 0, "TeleopTwistJoy",
+      "Blending with planner_cmd_vel, weighted by axis %" PRId64 ".", pimpl_->blend_weight_axis);
+    pimpl_->planner_sub = this->create_subscription<geometry_msgs::msg::Twist>("planner_cmd_vel", rclcpp::QoS(10),
+      std::bind(&TeleopTwistJoy::Impl::plannerCallback, this->pimpl_, std::placeholders::_1));
+  }
+
+  pimpl_->analytics_enabled = this->declare_parameter("analytics", false, read_only);
+  double analytics_period = this->declare_parameter("analytics_period", 0.0, read_only);
+  if (pimpl_->analytics_enabled)
+  {
+    pimpl_->analytics_pub = this->create_publisher<diagnostic_msgs::msg::DiagnosticStatus>("~/analytics", 10);
+    pimpl_->analytics_srv = this->create_service<std_srvs::srv::Trigger>("~/get_analytics",
+      [this](const std::shared_ptr<std_srvs::srv::Trigger::Request>,
+             std::shared_ptr<std_srvs::srv::Trigger::Response> response)
+      {
+        auto snapshot = pimpl_->analyticsSnapshot();
+        for (const auto& kv : snapshot->values)
+        {
+          response->message += kv.key + "=" + kv.value + ";";
+        }
+        response->success = true;
+        pimpl_->analytics_pub->publish(std::move(snapshot));
+      });
+    if (analytics_period > 0.0)
+    {
+      pimpl_->analytics_timer = rclcpp::create_timer(this, pimpl_->clock,
+        rclcpp::Duration::from_seconds(analytics_period),
+        std::bind(&TeleopTwistJoy::Impl::analyticsCallback, this->pimpl_));
+    }
+  }
+
+  pimpl_->idle_timeout = this->declare_parameter("idle_timeout", 0.0, read_only);
+  pimpl_->idle_deadband = this->declare_parameter("idle_deadband", 0.05, read_only);
+  pimpl_->idle = false;
+  pimpl_->quiet = false;
+  ROS_INFO_COND_NAMED(pimpl_->idle_timeout > 0.0, "TeleopTwistJoy", "Idle after %f s without input.",
+    pimpl_->idle_timeout);
+
+  pimpl_->link_feedback = this->declare_parameter("link_feedback.enabled", false, read_only);
+  pimpl_->link_expected_period = this->declare_parameter("link_feedback.expected_period", 0.05, read_only);
+  pimpl_->link_age_threshold = this->declare_parameter("link_feedback.age_threshold", 0.15, read_only);
+  pimpl_->link_loss_threshold = this->declare_parameter("link_feedback.loss_threshold", 0.2, read_only);
+  pimpl_->link_feedback_period = this->declare_parameter("link_feedback.min_period", 0.5, read_only);
+  pimpl_->link_feedback_intensity = this->declare_parameter("link_feedback.intensity", 0.6, read_only);
+  pimpl_->link_input_age = 0.0;
+  pimpl_->link_loss = 0.0;
+  pimpl_->link_degraded = false;
+  pimpl_->link_last_arrival = pimpl_->clock->now();
+  pimpl_->link_last_feedback = pimpl_->link_last_arrival;
+  if (pimpl_->link_feedback && pimpl_->link_expected_period <= 0.0)
+  {
+    RCLCPP_WARN(this->get_logger(), "link_feedback.expected_period must be positive, disabling link feedback.");
+    pimpl_->link_feedback = false;
+  }
+  if (pimpl_->link_feedback)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Rumble when input is older than %f s or %f of it is lost.",
+      pimpl_->link_age_threshold, pimpl_->link_loss_threshold);
+    pimpl_->feedback_pub = this->create_publisher<sensor_msgs::msg::JoyFeedbackArray>("joy/set_feedback", 10);
+  }
+
+  pimpl_->heading_hold = this->declare_parameter("heading_hold.enabled", false, read_only);
+  pimpl_->heading_hold_kp = this->declare_parameter("heading_hold.kp", 1.0, read_only);
+  pimpl_->heading_hold_ki = this->declare_parameter("heading_hold.ki", 0.5, read_only);
+  pimpl_->heading_hold_deadband = this->declare_parameter("heading_hold.deadband", 0.05, read_only);
+  pimpl_->heading_hold_max_correction = this->declare_parameter("heading_hold.max_correction", 0.3, read_only);
+  pimpl_->heading_hold_imu_timeout = this->declare_parameter("heading_hold.imu_timeout", 0.2, read_only);
+  pimpl_->imu_yaw_rate = 0.0;
+  pimpl_->imu_stamp_ns = 0;
+  pimpl_->heading_error = 0.0;
+  pimpl_->heading_holding = false;
+  if (pimpl_->heading_hold)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Heading hold with kp %f, ki %f.", pimpl_->heading_hold_kp,
+      pimpl_->heading_hold_ki);
+    pimpl_->imu_sub = this->create_subscription<sensor_msgs::msg::Imu>("imu", rclcpp::SensorDataQoS(),
+      std::bind(&TeleopTwistJoy::Impl::imuCallback, this->pimpl_, std::placeholders::_1));
+  }
+
+  pimpl_->macro_record_button = this->declare_parameter("macro_record_button", -1, read_only);
+  pimpl_->macro_play_button = this->declare_parameter("macro_play_button", -1, read_only);
+  pimpl_->macro_abort_deadband = this->declare_parameter("macro_abort_deadband", 0.1, read_only);
+  pimpl_->macro_file = this->declare_parameter("macro_file", std::string(""), read_only);
+  int64_t macro_max_samples = this->declare_parameter("macro_max_samples", 20000, read_only);
+  pimpl_->macro = Macro(macro_max_samples > 0 ? macro_max_samples : 0);
+  pimpl_->macro_recording = false;
+  pimpl_->macro_record_pressed = false;
+  pimpl_->macro_play_pressed = false;
+  pimpl_->macro_playing = false;
+  pimpl_->macro_abort = false;
+  if (!pimpl_->macro_file.empty())
+  {
+    std::string error;
+    if (pimpl_->macro.load(pimpl_->macro_file, error))
+    {
+      ROS_INFO_NAMED("TeleopTwistJoy", "Loaded macro of %zu commands from %s.", pimpl_->macro.size(),
+        pimpl_->macro_file.c_str());
+    }
+    else
+    {
+      ROS_WARN_NAMED("TeleopTwistJoy", "Not loading macro from %s: %s. Playback is empty until one is recorded.",
+        pimpl_->macro_file.c_str(), error.c_str());
+    }
+  }
+  ROS_INFO_COND_NAMED(pimpl_->macro_record_button >= 0, "TeleopTwistJoy",
+    "Macro record on button %" PRId64 ".", pimpl_->macro_record_button);
+  if (pimpl_->macro_play_button >= 0)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Macro playback on button %" PRId64 ".", pimpl_->macro_play_button);
+    pimpl_->macro_waitable = std::make_shared<GuardWaitable>(this->get_node_base_interface()->get_context(),
+      std::bind(&TeleopTwistJoy::Impl::macroCallback, this->pimpl_));
+    this->get_node_waitables_interface()->add_waitable(pimpl_->macro_waitable, nullptr);
+  }
+
+  pimpl_->fleet_robot_ids = this->declare_parameter("fleet.robot_ids", std::vector<int64_t>(), read_only);
+  pimpl_->fleet_robot_gains = this->declare_parameter("fleet.robot_gains", std::vector<double>(), read_only);
+  if (pimpl_->fleet_robot_gains.size() != pimpl_->fleet_robot_ids.size())
+  {
+    if (!pimpl_->fleet_robot_gains.empty())
+    {
+      RCLCPP_WARN(this->get_logger(), "fleet.robot_gains must have one gain per robot, using 1.0 for all.");
+    }
+    pimpl_->fleet_robot_gains.assign(pimpl_->fleet_robot_ids.size(), 1.0);
+  }
+  if (!pimpl_->fleet_robot_ids.empty())
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Packing commands for %zu robots on cmd_vel_fleet.",
+      pimpl_->fleet_robot_ids.size());
+    pimpl_->fleet_pub = this->create_publisher<std_msgs::msg::Float64MultiArray>("cmd_vel_fleet", 10);
+  }
+
+  const bool publish_offload = this->declare_parameter("publish_thread.enabled", false, read_only);
+  pimpl_->publish_thread_priority = this->declare_parameter("publish_thread.priority", 0, read_only);
+  pimpl_->publish_thread_cpu = this->declare_parameter("publish_thread.cpu", -1, read_only);
+  pimpl_->publish_stop = false;
+  pimpl_->publish_overflowed = false;
+  pimpl_->publisher_sleeping = false;
+  if (publish_offload)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Publishing cmd_vel from a dedicated thread.");
+    pimpl_->publish_queue.reset(new SpscRing<geometry_msgs::msg::Twist, Impl::PUBLISH_QUEUE_CAPACITY>());
+    pimpl_->publish_thread = std::thread(&TeleopTwistJoy::Impl::publisherThread, pimpl_);
+  }
+
+  std::string event_log_prefix = this->declare_parameter("event_log", std::string(""), read_only);
+  int64_t event_log_max_file_size = this->declare_parameter("event_log.max_file_size", 10485760, read_only);
+  int64_t event_log_max_files = this->declare_parameter("event_log.max_files", 10, read_only);
+  pimpl_->last_mode = Impl::MODE_DISABLED;
+  if (!event_log_prefix.empty())
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Logging events to %s.*.evlog.", event_log_prefix.c_str());
+    pimpl_->event_log.reset(new EventLog(event_log_prefix,
+      static_cast<uint64_t>(std::max<int64_t>(event_log_max_file_size, 0)),
+      static_cast<uint32_t>(std::max<int64_t>(event_log_max_files, 1))));
+  }
+
+  std::string recorder_prefix = this->declare_parameter("recorder", std::string(""), read_only);
+  int64_t recorder_max_file_size = this->declare_parameter("recorder.max_file_size", 67108864, read_only);
+  int64_t recorder_max_files = this->declare_parameter("recorder.max_files", 8, read_only);
+  if (!recorder_prefix.empty())
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Recording joy and cmd_vel to %s.*.ttjr.", recorder_prefix.c_str());
+    pimpl_->recorder.reset(new Recorder(recorder_prefix,
+      static_cast<uint64_t>(std::max<int64_t>(recorder_max_file_size, 0)),
+      static_cast<uint32_t>(std::max<int64_t>(recorder_max_files, 1))));
+  }
+
+  pimpl_->stats.last_report = pimpl_->last_joy_time;
+  double stats_period = this->declare_parameter("stats_period", 0.0, read_only);
+  if (stats_period > 0.0)
+  {
+    pimpl_->stats_pub = this->create_publisher<diagnostic_msgs::msg::DiagnosticStatus>("~/stats", 10);
+    pimpl_->stats_timer = rclcpp::create_timer(this, pimpl_->clock,
+      rclcpp::Duration::from_seconds(stats_period),
+      std::bind(&TeleopTwistJoy::Impl::statsCallback, this->pimpl_));
+  }
+
   auto param_callback =
   [this](std::vector<rclcpp::Parameter> parameters)
   {
@@ -216,6 +1127,21 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
     auto result = rcl_interfaces::msg::SetParametersResult();
     result.successful = true;
 
+#if defined(TELEOP_TWIST_JOY_FIXED_PROFILE) && !defined(TELEOP_TWIST_JOY_FIXED_PROFILE_OVERRIDES)
+    for (const auto & parameter : parameters)
+    {
+      if (intparams.count(parameter.get_name()) == 1 || doubleparams.count(parameter.get_name()) == 1 ||
+          boolparams.count(parameter.get_name()) == 1 || parameter.get_name() == "pipeline")
+      {
+        result.reason = "'" + parameter.get_name() + "' is fixed at build time by " + kFixedProfileSource + ".";
+        RCLCPP_WARN(this->get_logger(), result.reason.c_str());
+        pimpl_->logRejection(parameter.get_name(), REJECT_FIXED_PROFILE);
+        result.successful = false;
+        return result;
+      }
+    }
+#endif
+
     // Loop to check if changed parameters are of expected data type
     for(const auto & parameter : parameters)
     {
@@ -225,6 +1151,7 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
         {
           result.reason = "Only integer values can be set for '" + parameter.get_name() + "'.";
           RCLCPP_WARN(this->get_logger(), result.reason.c_str());
+          pimpl_->logRejection(parameter.get_name(), REJECT_WRONG_TYPE);
           result.successful = false;
           return result;
         }
@@ -235,6 +1162,7 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
         {
           result.reason = "Only double values can be set for '" + parameter.get_name() + "'.";
           RCLCPP_WARN(this->get_logger(), result.reason.c_str());
+          pimpl_->logRejection(parameter.get_name(), REJECT_WRONG_TYPE);
           result.successful = false;
           return result;
         }
@@ -245,140 +1173,55 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
         {
           result.reason = "Only boolean values can be set for '" + parameter.get_name() + "'.";
           RCLCPP_WARN(this->get_logger(), result.reason.c_str());
+          pimpl_->logRejection(parameter.get_name(), REJECT_WRONG_TYPE);
+          result.successful = false;
+          return result;
+        }
+      }
+      else if (parameter.get_name() == "pipeline")
+      {
+        CompiledConfig scratch;
+        std::string error;
+        if (parameter.get_type() != rclcpp::ParameterType::PARAMETER_STRING_ARRAY)
+        {
+          result.reason = "Only string arrays can be set for 'pipeline'.";
+        }
+        else if (!parsePipeline(parameter.get_value<rclcpp::PARAMETER_STRING_ARRAY>(), scratch, error))
+        {
+          result.reason = "Invalid pipeline: " + error + ".";
+        }
+        if (!result.reason.empty())
+        {
+          RCLCPP_WARN(this->get_logger(), result.reason.c_str());
+          pimpl_->logRejection(parameter.get_name(), REJECT_INVALID_VALUE);
           result.successful = false;
           return result;
         }
       }
     }
 
-    // Loop to assign changed parameters to the member variables
-    for (const auto & parameter : parameters)
+    // Validation above stays synchronous so rejections are reported to the caller. Accepted
+    // updates are either applied now or staged and applied as one batch per debounce window.
+    if (pimpl_->reporting_profile)
     {
-      if (parameter.get_name() == "require_enable_button")
-      {
-        this->pimpl_->require_enable_button = parameter.get_value<rclcpp::PARAMETER_BOOL>();
-      }
-      if (parameter.get_name() == "enable_button")
-      {
-        this->pimpl_->enable_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "enable_turbo_button")
-      {
-        this->pimpl_->enable_turbo_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "enable_autorun_button")
-      {
-          this->pimpl_->enable_autorun_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_linear.x")
-      {
-        this->pimpl_->axis_linear_map["x"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_linear.y")
-      {
-        this->pimpl_->axis_linear_map["y"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_linear.z")
-      {
-        this->pimpl_->axis_linear_map["z"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular_adjustment.yaw")
-      {
-          this->pimpl_->axis_angular_adjustment_map["yaw"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular_adjustment.pitch")
-      {
-          this->pimpl_->axis_angular_adjustment_map["pitch"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular_adjustment.roll")
-      {
-          this->pimpl_->axis_angular_adjustment_map["roll"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular.yaw")
-      {
-        this->pimpl_->axis_angular_map["yaw"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular.pitch")
-      {
-        this->pimpl_->axis_angular_map["pitch"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "axis_angular.roll")
-      {
-        this->pimpl_->axis_angular_map["roll"] = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
-      }
-      else if (parameter.get_name() == "scale_linear_autorun.x")
-      {
-        this->pimpl_->scale_linear_map["autorun"]["x"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear_autorun.y")
-      {
-        this->pimpl_->scale_linear_map["autorun"]["y"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear_autorun.z")
-      {
-        this->pimpl_->scale_linear_map["autorun"]["z"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear_turbo.x")
-      {
-        this->pimpl_->scale_linear_map["turbo"]["x"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear_turbo.y")
-      {
-        this->pimpl_->scale_linear_map["turbo"]["y"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear_turbo.z")
-      {
-        this->pimpl_->scale_linear_map["turbo"]["z"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear.x")
-      {
-        this->pimpl_->scale_linear_map["normal"]["x"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear.y")
-      {
-        this->pimpl_->scale_linear_map["normal"]["y"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_linear.z")
-      {
-        this->pimpl_->scale_linear_map["normal"]["z"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_autorun.yaw")
-      {
-        this->pimpl_->scale_angular_map["autorun"]["yaw"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_autorun.pitch")
-      {
-        this->pimpl_->scale_angular_map["autorun"]["pitch"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_autorun.roll")
-      {
-        this->pimpl_->scale_angular_map["autorun"]["roll"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_turbo.yaw")
-      {
-        this->pimpl_->scale_angular_map["turbo"]["yaw"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_turbo.pitch")
-      {
-        this->pimpl_->scale_angular_map["turbo"]["pitch"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular_turbo.roll")
+      return result;
+    }
+    if (pimpl_->parameter_debounce > 0.0)
+    {
+      for (const auto & parameter : parameters)
       {
-        this->pimpl_->scale_angular_map["turbo"]["roll"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
+        pimpl_->pending_parameters[parameter.get_name()] = parameter;
+        ++pimpl_->stats.parameters_staged;
       }
-      else if (parameter.get_name() == "scale_angular.yaw")
+      if (pimpl_->debounce_timer->is_canceled())
       {
-        this->pimpl_->scale_angular_map["normal"]["yaw"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular.pitch")
-      {
-        this->pimpl_->scale_angular_map["normal"]["pitch"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
-      }
-      else if (parameter.get_name() == "scale_angular.roll")
-      {
-        this->pimpl_->scale_angular_map["normal"]["roll"] = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
+        pimpl_->debounce_timer->reset();
       }
     }
+    else
+    {
+      pimpl_->applyParameters(parameters);
+    }
     return result;
   };
 
@@ -387,38 +1230,243 @@ TeleopTwistJoy::TeleopTwistJoy(const rclcpp::NodeOptions& options) : Node("teleo
 
 TeleopTwistJoy::~TeleopTwistJoy()
 {
+  {
+    std::lock_guard<std::mutex> lock(pimpl_->macro_mutex);
+    pimpl_->macro_abort = true;
+  }
+  pimpl_->macro_cv.notify_one();
+  if (pimpl_->macro_thread.joinable())
+  {
+    pimpl_->macro_thread.join();
+  }
+  if (pimpl_->publish_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(pimpl_->publish_mutex);
+      pimpl_->publish_stop = true;
+    }
+    pimpl_->publish_cv.notify_one();
+    pimpl_->publish_thread.join();
+  }
   delete pimpl_;
 }
 
-double getVal(const sensor_msgs::msg::Joy::SharedPtr joy_msg, const std::map<std::string, int64_t>& axis_map,
-              const std::map<std::string, double>& scale_map, const std::string& fieldname)
+/**
+ * Points axis or scale at the table entry behind an axis_* or scale_* parameter such as
+ * "axis_angular.yaw" or "scale_linear_turbo.x". Returns false for any other name.
+ */
+bool configEntry(CompiledConfig& cfg, const std::string& name, int64_t*& axis, double*& scale)
 {
-    // fieldname が axis_map のどのインデックスにあるか 
-  if (axis_map.find(fieldname) == axis_map.end() ||
-      axis_map.at(fieldname) == -1L ||
-      scale_map.find(fieldname) == scale_map.end() ||
-      static_cast<int>(joy_msg->axes.size()) <= axis_map.at(fieldname)) // 
+  static const char* field_names[NUM_FIELDS] = {"x", "y", "z", "yaw", "pitch", "roll"};
+  static const char* scale_suffixes[NUM_SCALES] = {"", "_turbo", "_autorun"};
+
+  const size_t dot = name.find('.');
+  if (dot == std::string::npos)
   {
-    return 0.0;
+    return false;
+  }
+  const std::string group = name.substr(0, dot);
+  int field = 0;
+  while (field < NUM_FIELDS && name.compare(dot + 1, std::string::npos, field_names[field]) != 0)
+  {
+    ++field;
+  }
+  if (field == NUM_FIELDS)
+  {
+    return false;
+  }
+
+  const bool linear = field < FIELD_ANGULAR_YAW;
+  if (group == (linear ? "axis_linear" : "axis_angular"))
+  {
+    axis = &cfg.axis[field];
+    return true;
+  }
+  if (!linear && group == "axis_angular_adjustment")
+  {
+    axis = &cfg.adjustment_axis[field];
+    return true;
+  }
+  for (int s = 0; s < NUM_SCALES; ++s)
+  {
+    if (group == std::string(linear ? "scale_linear" : "scale_angular") + scale_suffixes[s])
+    {
+      scale = &cfg.scale[s][field];
+      return true;
+    }
+  }
+  return false;
+}
+
+void TeleopTwistJoy::Impl::applyParameters(const std::vector<rclcpp::Parameter>& parameters)
+{
+  // Changes are written into a copy of the current table, which is then interned in its place.
+  CompiledConfig cfg = *config;
+  for (const auto & parameter : parameters)
+  {
+    int64_t* axis = nullptr;
+    double* scale = nullptr;
+    if (parameter.get_name() == "require_enable_button")
+    {
+      cfg.require_enable_button = parameter.get_value<rclcpp::PARAMETER_BOOL>();
+    }
+    else if (parameter.get_name() == "enable_button")
+    {
+      cfg.enable_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
+    }
+    else if (parameter.get_name() == "enable_turbo_button")
+    {
+      cfg.enable_turbo_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
+    }
+    else if (parameter.get_name() == "enable_autorun_button")
+    {
+      cfg.enable_autorun_button = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
+    }
+    else if (parameter.get_name() == "pipeline")
+    {
+      // Validated by the parameter callback before it gets here.
+      std::string error;
+      parsePipeline(parameter.get_value<rclcpp::PARAMETER_STRING_ARRAY>(), cfg, error);
+      // Filter state and timings belong to the old stage list.
+      resetPipeline(pipeline_state);
+#ifndef NDEBUG
+      stage_timer = StageTimer();
+#endif
+    }
+    else if (configEntry(cfg, parameter.get_name(), axis, scale))
+    {
+      if (axis)
+      {
+        *axis = parameter.get_value<rclcpp::PARAMETER_INTEGER>();
+      }
+      else
+      {
+        *scale = parameter.get_value<rclcpp::PARAMETER_DOUBLE>();
+      }
+    }
+  }
+
+  config = internConfig(cfg);
+  ++stats.config_rebuilds;
+}
+
+void TeleopTwistJoy::Impl::debounceCallback()
+{
+  ++stats.wakeups;
+  debounce_timer->cancel();
+
+  std::vector<rclcpp::Parameter> parameters;
+  parameters.reserve(pending_parameters.size());
+  for (const auto& parameter : pending_parameters)
+  {
+    parameters.push_back(parameter.second);
+  }
+  pending_parameters.clear();
+  applyParameters(parameters);
+}
+
+std::vector<rclcpp::Parameter> TeleopTwistJoy::Impl::profileParameters(const CompiledConfig& cfg,
+  const std::vector<std::string>& pipeline) const
+{
+  static const char* field_names[NUM_FIELDS] = {"x", "y", "z", "yaw", "pitch", "roll"};
+  static const char* scale_suffixes[NUM_SCALES] = {"", "_turbo", "_autorun"};
+
+  std::vector<rclcpp::Parameter> parameters;
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    const bool linear = field < FIELD_ANGULAR_YAW;
+    const std::string name = field_names[field];
+    parameters.emplace_back((linear ? "axis_linear." : "axis_angular.") + name, cfg.axis[field]);
+    if (!linear)
+    {
+      parameters.emplace_back("axis_angular_adjustment." + name, cfg.adjustment_axis[field]);
+    }
+    for (int scale = 0; scale < NUM_SCALES; ++scale)
+    {
+      parameters.emplace_back(std::string(linear ? "scale_linear" : "scale_angular") + scale_suffixes[scale] + "." + name,
+        cfg.scale[scale][field]);
+    }
   }
+  parameters.emplace_back("require_enable_button", cfg.require_enable_button);
+  parameters.emplace_back("enable_button", cfg.enable_button);
+  parameters.emplace_back("enable_turbo_button", cfg.enable_turbo_button);
+  parameters.emplace_back("enable_autorun_button", cfg.enable_autorun_button);
+  parameters.emplace_back("pipeline", pipeline);
+  return parameters;
+}
 
-  return joy_msg->axes[axis_map.at(fieldname)] * scale_map.at(fieldname);
+void TeleopTwistJoy::Impl::matchProfile(const sensor_msgs::msg::Joy& joy_msg)
+{
+  const ProfileDbEntry* entry = profile_db->find(static_cast<uint32_t>(joy_msg.axes.size()),
+    static_cast<uint32_t>(joy_msg.buttons.size()), device_name);
+  if (!entry)
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "No profile for %zu axes and %zu buttons, keeping the configured mapping.",
+      joy_msg.axes.size(), joy_msg.buttons.size());
+  }
+  else
+  {
+    ROS_INFO_NAMED("TeleopTwistJoy", "Using profile %.64s for %zu axes and %zu buttons.", entry->source,
+      joy_msg.axes.size(), joy_msg.buttons.size());
+    // Joint jog stays as configured; everything else comes from the profile.
+    CompiledConfig cfg = entry->config;
+    std::vector<std::string> stages;
+    for (int64_t stage = 0; stage < cfg.num_stages; ++stage)
+    {
+      stages.emplace_back(entry->pipeline[stage], strnlen(entry->pipeline[stage], sizeof(entry->pipeline[stage])));
+    }
+    cfg.num_joints = config->num_joints;
+    std::copy(config->joint_axis, config->joint_axis + MAX_JOINTS, cfg.joint_axis);
+    std::copy(&config->joint_scale[0][0], &config->joint_scale[0][0] + NUM_SCALES * MAX_JOINTS, &cfg.joint_scale[0][0]);
+    config = internConfig(cfg);
+    ++stats.config_rebuilds;
+    resetPipeline(pipeline_state);
+    reporting_profile = true;
+    set_node_parameters(profileParameters(entry->config, stages));
+    reporting_profile = false;
+  }
+  profile_db.reset();
 }
 
-void TeleopTwistJoy::Impl::sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr joy_msg,
-                                         const std::string& which_map)
+void TeleopTwistJoy::Impl::sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr joy_msg, int which_scale)
 {
+  const CompiledConfig& cfg = activeConfig();
+  const double* scale = cfg.scale[which_scale];
+
+  double stick[NUM_FIELDS];
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    stick[field] = axisValue(*joy_msg, cfg.axis[field]);
+  }
+  if (cfg.num_stages > 0)
+  {
+    const auto now = input_time;
+    if (sent_disable_msg)
+    {
+      // Filters start again from the stick rather than from before the stop.
+      resetPipeline(pipeline_state);
+    }
+#ifndef NDEBUG
+    runPipeline(cfg, pipeline_state, (now - last_pipeline_time).seconds(), stick, stage_timer);
+    ++stage_timer.runs;
+#else
+    NoStageTimer timer;
+    runPipeline(cfg, pipeline_state, (now - last_pipeline_time).seconds(), stick, timer);
+#endif
+    last_pipeline_time = now;
+  }
+
   // Initializes with zeros by default.
   auto cmd_vel_msg = std::make_unique<geometry_msgs::msg::Twist>();
-  float_t speed_x_temporary = getVal(joy_msg, axis_linear_map, scale_linear_map[which_map], "x");
-  float_t speed_yaw_temporary = getVal(joy_msg, axis_angular_map, scale_angular_map[which_map], "yaw");
+  float_t speed_x_temporary = stick[FIELD_LINEAR_X] * scale[FIELD_LINEAR_X];
+  float_t speed_yaw_temporary = stick[FIELD_ANGULAR_YAW] * scale[FIELD_ANGULAR_YAW];
 
   if(this->autorun_flag)
   {
       // 直進方向の値を更新
       float_t limit;
       // x の値の最大値を決定
-      limit = 1.0f * scale_linear_map["autorun"]["x"];
+      limit = 1.0f * cfg.scale[SCALE_AUTORUN][FIELD_LINEAR_X];
       // 十字キーの値を / 10 してから足す
       this->speed_x_max += (float_t) speed_x_temporary / 10;
       // 出力値が最大値を超えないように制限
@@ -428,11 +1476,11 @@ void TeleopTwistJoy::Impl::sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr
       cmd_vel_msg->linear.x = this->speed_x_max;
 
       // 角度方向の値を更新
-      float_t joystick = getVal(joy_msg, axis_angular_adjustment_map, scale_angular_map[which_map], "yaw");
+      float_t joystick = axisValue(*joy_msg, cfg.adjustment_axis[FIELD_ANGULAR_YAW]) * scale[FIELD_ANGULAR_YAW];
       // Joystick の値と十字キーの値を加算
       float_t sum = (speed_yaw_temporary + joystick);
       // yaw の値の最大値を決定 ( 十字キーの最大値で制限 )
-      limit = 1.0f * scale_angular_map["autorun"]["yaw"];
+      limit = 1.0f * cfg.scale[SCALE_AUTORUN][FIELD_ANGULAR_YAW];
       // Joystick と十字キーを加算した値が最大値の範囲に収まるように制限
       sum = sum >  limit ?  limit : sum;
       sum = sum < -limit ? -limit : sum;
@@ -445,62 +1493,1328 @@ void TeleopTwistJoy::Impl::sendCmdVelMsg(const sensor_msgs::msg::Joy::SharedPtr
       cmd_vel_msg->angular.z = speed_yaw_temporary;
   }
 
-  cmd_vel_msg->linear.y = getVal(joy_msg, axis_linear_map, scale_linear_map[which_map], "y");
-  cmd_vel_msg->linear.z = getVal(joy_msg, axis_linear_map, scale_linear_map[which_map], "z");
-  cmd_vel_msg->angular.y = getVal(joy_msg, axis_angular_map, scale_angular_map[which_map], "pitch");
-  cmd_vel_msg->angular.x = getVal(joy_msg, axis_angular_map, scale_angular_map[which_map], "roll");
+  cmd_vel_msg->linear.y = stick[FIELD_LINEAR_Y] * scale[FIELD_LINEAR_Y];
+  cmd_vel_msg->linear.z = stick[FIELD_LINEAR_Z] * scale[FIELD_LINEAR_Z];
+  cmd_vel_msg->angular.y = stick[FIELD_ANGULAR_PITCH] * scale[FIELD_ANGULAR_PITCH];
+  cmd_vel_msg->angular.x = stick[FIELD_ANGULAR_ROLL] * scale[FIELD_ANGULAR_ROLL];
 
-  cmd_vel_pub->publish(std::move(cmd_vel_msg));
+  if (heading_hold)
+  {
+    applyHeadingHold(*cmd_vel_msg, input_time);
+  }
+
+  // The first command after a stop always goes out, whatever the rate.
+  if (sent_disable_msg || !adaptive_rate || adaptiveRateAllows(*cmd_vel_msg))
+  {
+    publishCmdVel(std::move(cmd_vel_msg));
+  }
+  else
+  {
+    // Held rather than dropped, so the latest command, a return to zero included, always goes
+    // out once the rate allows. Only commands superseded while waiting are skipped.
+    stats.adaptive_rate_skipped += pending_cmd_vel ? 1 : 0;
+    pending_cmd_vel = std::move(cmd_vel_msg);
+  }
   sent_disable_msg = false;
 }
 
-void TeleopTwistJoy::Impl::joyCallback(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
+void TeleopTwistJoy::Impl::sendJointJogMsg(const sensor_msgs::msg::Joy& joy_msg, int which_scale)
+{
+  const CompiledConfig& cfg = activeConfig();
+  const double* scale = cfg.joint_scale[which_scale];
+
+  auto joint_msg = std::make_unique<sensor_msgs::msg::JointState>();
+  joint_msg->header.stamp = clock->now();
+  joint_msg->name = joint_names;
+  joint_msg->velocity.resize(cfg.num_joints);
+  for (int64_t joint = 0; joint < cfg.num_joints; ++joint)
+  {
+    joint_msg->velocity[joint] = axisValue(joy_msg, cfg.joint_axis[joint]) * scale[joint];
+  }
+  if (batch_holding)
+  {
+    held_joint_msg = std::move(joint_msg);
+  }
+  else
+  {
+    joint_jog_pub->publish(std::move(joint_msg));
+  }
+  sent_joint_stop = false;
+}
+
+void TeleopTwistJoy::Impl::sendJointStop(const rclcpp::Time& now)
+{
+  auto joint_msg = std::make_unique<sensor_msgs::msg::JointState>();
+  joint_msg->header.stamp = now;
+  joint_msg->name = joint_names;
+  joint_msg->velocity.assign(joint_names.size(), 0.0);
+  if (batch_holding)
+  {
+    held_joint_msg = std::move(joint_msg);
+  }
+  else
+  {
+    joint_jog_pub->publish(std::move(joint_msg));
+  }
+  sent_joint_stop = true;
+}
+
+void TeleopTwistJoy::Impl::switchOutput(const rclcpp::Time& now)
 {
-    if(enable_autorun_button >= 0 && static_cast<int>(joy_msg->buttons.size()) > enable_autorun_button)
+  // Whatever was being driven is stopped before the other output takes the sticks.
+  if (arm_mode)
+  {
+    sendJointStop(now);
+  }
+  else
+  {
+    if (macro_playing)
     {
-        auto autorun_button = joy_msg->buttons[enable_autorun_button];
-        if(autorun_button - this->autorun_buffer > 0)
-        {
-            this->autorun_flag = this->autorun_flag ? false : true;
-        }
-        this->autorun_buffer = autorun_button;
+      abortPlayback();
+    }
+    // Initializes with zeros by default.
+    publishCmdVel(std::make_unique<geometry_msgs::msg::Twist>());
+    sent_disable_msg = true;
+    // Autorun would otherwise resume driving the base on the way back.
+    autorun_flag = false;
+  }
+  logEvent(EVENT_STOP, STOP_OUTPUT_SWITCH);
+  arm_mode = !arm_mode;
+  logEvent(EVENT_OUTPUT_SWITCH, arm_mode ? 1 : 0);
+  ROS_INFO_NAMED("TeleopTwistJoy", "Sticks now drive %s.", arm_mode ? "joint_jog" : "cmd_vel");
+}
+
+void TeleopTwistJoy::Impl::updateLinkFeedback(const sensor_msgs::msg::Joy& joy_msg, const rclcpp::Time& now)
+{
+  // Both metrics are EWMAs over about ten messages: a few arithmetic operations per message.
+  const double alpha = 0.1;
+  if (joy_msg.header.stamp.sec != 0 || joy_msg.header.stamp.nanosec != 0)
+  {
+    const rclcpp::Time stamp(joy_msg.header.stamp, now.get_clock_type());
+    link_input_age += alpha * (std::max(0.0, (now - stamp).seconds()) - link_input_age);
+  }
+
+  // A gap of n expected periods means n - 1 messages were lost. Gaps over a second are pauses
+  // of the driver, which dropout handling deals with, not loss.
+  const double gap = (now - link_last_arrival).seconds();
+  link_last_arrival = now;
+  if (gap < 1.0)
+  {
+    const double expected = std::max(1.0, std::round(gap / link_expected_period));
+    link_loss += alpha * ((expected - 1.0) / expected - link_loss);
+  }
+
+  const double severity = std::max(link_input_age / link_age_threshold, link_loss / link_loss_threshold);
+  const bool degraded = severity >= 1.0;
+  if (degraded == link_degraded && (!degraded || (now - link_last_feedback).seconds() < link_feedback_period))
+  {
+    return;
+  }
+
+  // Pulses at most every min_period while degraded, and one message to stop when it recovers.
+  link_degraded = degraded;
+  link_last_feedback = now;
+  auto feedback_msg = std::make_unique<sensor_msgs::msg::JoyFeedbackArray>();
+  sensor_msgs::msg::JoyFeedback rumble;
+  rumble.type = sensor_msgs::msg::JoyFeedback::TYPE_RUMBLE;
+  rumble.id = 0;
+  rumble.intensity = degraded ? std::min(1.0, link_feedback_intensity * severity) : 0.0;
+  feedback_msg->array.push_back(rumble);
+  ++stats.link_feedback_msgs;
+  feedback_pub->publish(std::move(feedback_msg));
+}
+
+void TeleopTwistJoy::Impl::imuCallback(const sensor_msgs::msg::Imu::SharedPtr imu)
+{
+  ++stats.wakeups;
+  imu_yaw_rate.store(imu->angular_velocity.z, std::memory_order_relaxed);
+  imu_stamp_ns.store(clock->now().nanoseconds(), std::memory_order_release);
+}
+
+void TeleopTwistJoy::Impl::applyHeadingHold(geometry_msgs::msg::Twist& cmd_vel, const rclcpp::Time& now)
+{
+  const int64_t stamp_ns = imu_stamp_ns.load(std::memory_order_acquire);
+  const double yaw_rate = imu_yaw_rate.load(std::memory_order_relaxed);
+  const bool imu_fresh = stamp_ns > 0 && (now.nanoseconds() - stamp_ns) * 1e-9 < heading_hold_imu_timeout;
+  // A hold does not carry over a stop: the heading to keep is the one when driving resumed.
+  if (sent_disable_msg)
+  {
+    heading_holding = false;
+    heading_error = 0.0;
+  }
+  const double dt = heading_holding ? (now - last_heading_time).seconds() : 0.0;
+  last_heading_time = now;
+
+  // The operator is turning (by the commanded rate, so the autorun adjustment axis counts too),
+  // the robot is parked and must not spin in place, or there is nothing to close the loop on:
+  // start over next time.
+  const bool turning = std::abs(cmd_vel.angular.z) > heading_hold_deadband;
+  const bool parked = cmd_vel.linear.x == 0.0 && cmd_vel.linear.y == 0.0 && cmd_vel.linear.z == 0.0;
+  if (turning || parked || !imu_fresh)
+  {
+    stats.heading_hold_stale_imu += !imu_fresh && !turning && !parked;
+    heading_holding = false;
+    heading_error = 0.0;
+    return;
+  }
+
+  // With the stick centered the wanted yaw rate is zero, so the integral of the measured rate is
+  // the heading lost since the hold started.
+  heading_holding = true;
+  const double error = heading_error - yaw_rate * dt;
+  const double correction = -heading_hold_kp * yaw_rate + heading_hold_ki * error;
+  if (std::abs(correction) > heading_hold_max_correction)
+  {
+    // Saturated: the integral is not advanced, so it does not wind up.
+    cmd_vel.angular.z = std::copysign(heading_hold_max_correction, correction);
+  }
+  else
+  {
+    heading_error = error;
+    cmd_vel.angular.z = correction;
+  }
+  ++stats.heading_hold_corrections;
+}
+
+double maxAbsDiff(const geometry_msgs::msg::Twist& a, const geometry_msgs::msg::Twist& b)
+{
+  return std::max({std::abs(a.linear.x - b.linear.x), std::abs(a.linear.y - b.linear.y),
+                   std::abs(a.linear.z - b.linear.z), std::abs(a.angular.x - b.angular.x),
+                   std::abs(a.angular.y - b.angular.y), std::abs(a.angular.z - b.angular.z)});
+}
+
+bool TeleopTwistJoy::Impl::adaptiveRateAllows(const geometry_msgs::msg::Twist& cmd_vel)
+{
+  // Timed on the input, so the samples of a batch are spaced as they were taken.
+  const auto now = input_time;
+  const double dt = (now - last_mapped_time).seconds();
+  const double derivative = dt > 0.0 ? maxAbsDiff(cmd_vel, last_mapped_cmd_vel) / dt : 0.0;
+  last_mapped_cmd_vel = cmd_vel;
+  last_mapped_time = now;
+
+  // Interpolate between the keepalive and full rate on the command derivative. A command that
+  // differs from what was last published is never left waiting for a keepalive slot.
+  double t = (derivative - adaptive_rate_low_threshold) / (adaptive_rate_high_threshold - adaptive_rate_low_threshold);
+  t = std::min(1.0, std::max(0.0, t));
+  if (maxAbsDiff(cmd_vel, last_cmd_vel) > 1e-6)
+  {
+    t = 1.0;
+  }
+  adaptive_target_rate = adaptive_rate_min + t * (adaptive_rate_max - adaptive_rate_min);
+
+  const double since_publish = (clock->now() - last_publish_time).seconds();
+  return since_publish * adaptive_target_rate >= 1.0;
+}
+
+void TeleopTwistJoy::Impl::adaptiveRateCallback()
+{
+  ++stats.wakeups;
+
+  // Playback and the joint output own the sticks; nothing held for cmd_vel applies any more.
+  if (macro_playing || arm_mode)
+  {
+    pending_cmd_vel.reset();
+    return;
+  }
+
+  const auto now = clock->now();
+  const double since_publish = (now - last_publish_time).seconds();
+  if (pending_cmd_vel)
+  {
+    if (since_publish * adaptive_target_rate >= 1.0)
+    {
+      publishCmdVel(std::move(pending_cmd_vel));
     }
+    return;
+  }
 
-    RCLCPP_INFO(rclcpp::get_logger("joy_callback_logger"), "B : %d, Flag : %d, sent_disable_msg : %d", joy_msg->buttons[enable_autorun_button], this->autorun_flag ? 1 : 0, sent_disable_msg ? 1 : 0);
+  // Keepalives of a steady command go out at the minimum rate whatever the Joy rate. A joystick
+  // silent for dropout_timeout is left to the dropout policy instead of being kept alive.
+  if (!sent_disable_msg && !in_dropout && (now - last_joy_time).seconds() < dropout_timeout &&
+      since_publish * adaptive_rate_min >= 1.0)
+  {
+    publishCmdVel(std::make_unique<geometry_msgs::msg::Twist>(last_mapped_cmd_vel));
+  }
+}
 
-    if(!autorun_flag)
+void TeleopTwistJoy::Impl::publishCmdVel(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg)
+{
+  if (batch_holding)
+  {
+    // Superseded by any later command of the same batch; published when the batch is done.
+    held_cmd_vel = std::move(cmd_vel_msg);
+    return;
+  }
+
+  // Whatever goes out supersedes a command held back by the adaptive rate, stops above all.
+  pending_cmd_vel.reset();
+
+  const auto now = clock->now();
+  if (blend_mode)
+  {
+    joy_cmd_vel = *cmd_vel_msg;
+    blendInto(*cmd_vel_msg, now);
+  }
+
+  const double interval = (now - last_publish_time).seconds();
+  if (interval > 0.0)
+  {
+    // Exponentially weighted so the reported rate follows changes within a few messages.
+    stats.cmd_vel_rate += 0.2 * (1.0 / interval - stats.cmd_vel_rate);
+  }
+  last_publish_time = now;
+
+  // Held/decayed commands are not fed back into last_cmd_vel, so the decay is always relative
+  // to the last command given before the dropout.
+  if (!in_dropout)
+  {
+    last_cmd_vel = *cmd_vel_msg;
+  }
+  if (macro_recording && !macro.record((now - macro_record_start).nanoseconds(), *cmd_vel_msg))
+  {
+    RCLCPP_WARN(rclcpp::get_logger("TeleopTwistJoy"), "Macro buffer full, stopping recording.");
+    finishRecording();
+  }
+  ++stats.cmd_vel_msgs;
+  sendToPublisher(std::move(cmd_vel_msg));
+}
+
+void TeleopTwistJoy::Impl::publishCommand(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg)
+{
+  if (fleet_pub)
+  {
+    // One row of [robot id, linear x y z, angular x y z] per robot, written straight into the
+    // message rather than through a Twist per robot.
+    const size_t robots = fleet_robot_ids.size();
+    auto fleet_msg = std::make_unique<std_msgs::msg::Float64MultiArray>();
+    fleet_msg->layout.dim.resize(2);
+    fleet_msg->layout.dim[0].label = "robot";
+    fleet_msg->layout.dim[0].size = robots;
+    fleet_msg->layout.dim[0].stride = robots * 7;
+    fleet_msg->layout.dim[1].label = "command";
+    fleet_msg->layout.dim[1].size = 7;
+    fleet_msg->layout.dim[1].stride = 7;
+    fleet_msg->data.resize(robots * 7);
+    double* row = fleet_msg->data.data();
+    for (size_t i = 0; i < robots; ++i, row += 7)
     {
-        // 直進速度をリセット
-        this->speed_x_max = 0;
+      const double gain = fleet_robot_gains[i];
+      row[0] = static_cast<double>(fleet_robot_ids[i]);
+      row[1] = gain * cmd_vel_msg->linear.x;
+      row[2] = gain * cmd_vel_msg->linear.y;
+      row[3] = gain * cmd_vel_msg->linear.z;
+      row[4] = gain * cmd_vel_msg->angular.x;
+      row[5] = gain * cmd_vel_msg->angular.y;
+      row[6] = gain * cmd_vel_msg->angular.z;
     }
+    fleet_pub->publish(std::move(fleet_msg));
+  }
+  cmd_vel_pub->publish(std::move(cmd_vel_msg));
+}
+
+void TeleopTwistJoy::Impl::sendToPublisher(std::unique_ptr<geometry_msgs::msg::Twist> cmd_vel_msg)
+{
+  if (recorder)
+  {
+    const double values[6] = {cmd_vel_msg->linear.x, cmd_vel_msg->linear.y, cmd_vel_msg->linear.z,
+                              cmd_vel_msg->angular.x, cmd_vel_msg->angular.y, cmd_vel_msg->angular.z};
+    recorder->recordOutput(clock->now().nanoseconds(), values);
+  }
+  if (!publish_queue)
+  {
+    publishCommand(std::move(cmd_vel_msg));
+    return;
+  }
 
-    if(autorun_flag)
+  // Once a command has gone to the overflow slot, later ones follow it there until the publish
+  // thread takes it, so none can overtake it through the ring.
+  if (publish_overflowed.load(std::memory_order_acquire) || !publish_queue->push(*cmd_vel_msg))
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    if (publish_overflowed.load(std::memory_order_relaxed) || !publish_queue->push(*cmd_vel_msg))
     {
-        sendCmdVelMsg(joy_msg, "autorun");
+      ++stats.publish_queue_full;
+      stats.publish_queue_superseded += publish_overflow ? 1 : 0;
+      publish_overflow = std::move(cmd_vel_msg);
+      publish_overflowed.store(true, std::memory_order_release);
     }
-    else if(enable_turbo_button >= 0 &&
-                static_cast<int>(joy_msg->buttons.size()) > enable_turbo_button &&
-                joy_msg->buttons[enable_turbo_button])
+    publish_cv.notify_one();
+    return;
+  }
+  // Pairs with the fence in publisherThread: either it sees the command before sleeping, or
+  // this sees it asleep and wakes it. The lock is only taken in the second case.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (publisher_sleeping.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    publish_cv.notify_one();
+  }
+}
+
+void TeleopTwistJoy::Impl::publisherThread()
+{
+  if (publish_thread_priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = static_cast<int>(publish_thread_priority);
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
     {
-        sendCmdVelMsg(joy_msg, "turbo");
+      RCLCPP_WARN(rclcpp::get_logger("TeleopTwistJoy"),
+        "Could not give the publish thread SCHED_FIFO priority %" PRId64 ".", publish_thread_priority);
     }
-    else if (!require_enable_button ||
-            (static_cast<int>(joy_msg->buttons.size()) > enable_button &&
-             joy_msg->buttons[enable_button]))
+  }
+#ifdef __linux__
+  if (publish_thread_cpu >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(static_cast<int>(publish_thread_cpu), &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
     {
-        sendCmdVelMsg(joy_msg, "normal");
+      RCLCPP_WARN(rclcpp::get_logger("TeleopTwistJoy"),
+        "Could not pin the publish thread to CPU %" PRId64 ".", publish_thread_cpu);
     }
-    else
+  }
+#endif
+
+  geometry_msgs::msg::Twist cmd_vel;
+  for (;;)
+  {
+    while (publish_queue->pop(cmd_vel))
     {
-        // RCLCPP_INFO(rclcpp::get_logger("joy_callback_logger"), "Stop The Robot : %d", !sent_disable_msg ? 1 : 0);
-        // When enable button is released, immediately send a single no-motion command
-        // in order to stop the robot.
-        if (!sent_disable_msg)
-        {
-            // Initializes with zeros by default.
-            auto cmd_vel_msg = std::make_unique<geometry_msgs::msg::Twist>();
-            cmd_vel_pub->publish(std::move(cmd_vel_msg));
-            sent_disable_msg = true;
+      publishCommand(std::make_unique<geometry_msgs::msg::Twist>(cmd_vel));
+    }
+
+    std::unique_lock<std::mutex> lock(publish_mutex);
+    if (publish_overflowed.load(std::memory_order_relaxed))
+    {
+      // The ring is drained and the executor pushes nothing while the flag is set, so this is
+      // the newest command and everything queued before it has gone out.
+      std::unique_ptr<geometry_msgs::msg::Twist> overflow = std::move(publish_overflow);
+      publish_overflowed.store(false, std::memory_order_release);
+      lock.unlock();
+      publishCommand(std::move(overflow));
+      continue;
+    }
+    if (publish_stop)
+    {
+      break;
+    }
+    publisher_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (publish_queue->empty())
+    {
+      publish_cv.wait(lock);
+    }
+    publisher_sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  // Commands queued before shutdown, the final stop included, still go out.
+  while (publish_queue->pop(cmd_vel))
+  {
+    publishCommand(std::make_unique<geometry_msgs::msg::Twist>(cmd_vel));
+  }
+  std::unique_lock<std::mutex> lock(publish_mutex);
+  std::unique_ptr<geometry_msgs::msg::Twist> overflow = std::move(publish_overflow);
+  lock.unlock();
+  if (overflow)
+  {
+    publishCommand(std::move(overflow));
+  }
+}
+
+void TeleopTwistJoy::Impl::sourceCallback(size_t source, const sensor_msgs::msg::Joy::SharedPtr joy)
+{
+  const auto now = clock->now();
+  source_samples[source] = JoySample{joy, now};
+
+  // Latest sample per source, with stale or missing ones left out of the fused message. The
+  // fused header is that of the newest input among the rest.
+  std::vector<const sensor_msgs::msg::Joy*>& latest = source_latest;
+  const sensor_msgs::msg::Joy* newest = joy.get();
+  auto newer = [](const builtin_interfaces::msg::Time& a, const builtin_interfaces::msg::Time& b)
+  {
+    return a.sec != b.sec ? a.sec > b.sec : a.nanosec > b.nanosec;
+  };
+  for (size_t i = 0; i < source_samples.size(); ++i)
+  {
+    latest[i] = nullptr;
+    const JoySample& sample = source_samples[i];
+    if (!sample.joy)
+    {
+      continue;
+    }
+    if ((now - sample.stamp).seconds() > joy_source_timeout)
+    {
+      ++stats.source_stale[i];
+      continue;
+    }
+    latest[i] = sample.joy.get();
+    if (newer(latest[i]->header.stamp, newest->header.stamp))
+    {
+      newest = latest[i];
+    }
+  }
+
+  // Buttons, and any axis not claimed by an output, come from the buttons source. Without it
+  // no button is pressed, so the enable button logic stops the robot.
+  sensor_msgs::msg::Joy& fused = *fused_joy;
+  const sensor_msgs::msg::Joy* buttons_joy = latest[source_buttons];
+  fused.header = newest->header;
+  fused.buttons.clear();
+  fused.axes.clear();
+  if (buttons_joy)
+  {
+    fused.buttons = buttons_joy->buttons;
+    fused.axes = buttons_joy->axes;
+  }
+
+  auto take_axis = [&fused, &latest](int64_t axis, int64_t source)
+  {
+    if (axis < 0)
+    {
+      return;
+    }
+    if (static_cast<int64_t>(fused.axes.size()) <= axis)
+    {
+      fused.axes.resize(axis + 1, 0.0f);
+    }
+    const sensor_msgs::msg::Joy* source_joy = latest[source];
+    fused.axes[axis] = (source_joy && static_cast<int64_t>(source_joy->axes.size()) > axis) ?
+      source_joy->axes[axis] : 0.0f;
+  };
+  const CompiledConfig& cfg = activeConfig();
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    take_axis(cfg.axis[field], source_field[field]);
+    take_axis(cfg.adjustment_axis[field], source_field[field]);
+  }
+
+  joyCallback(fused_joy);
+}
+
+void TeleopTwistJoy::Impl::socketCallback()
+{
+  ++stats.wakeups;
+  SocketFrame frame;
+  if (!socket_input->poll(frame))
+  {
+    return;
+  }
+
+  // Datagrams can be reordered; anything not newer than the last frame is dropped.
+  if (socket_have_sequence && static_cast<int32_t>(frame.sequence - socket_sequence) <= 0)
+  {
+    ++stats.socket_out_of_order;
+    return;
+  }
+  socket_sequence = frame.sequence;
+  socket_have_sequence = true;
+
+  sensor_msgs::msg::Joy& joy = *socket_joy;
+  joy.header.stamp.sec = static_cast<int32_t>(frame.stamp_ns / 1000000000);
+  joy.header.stamp.nanosec = static_cast<uint32_t>(frame.stamp_ns % 1000000000);
+  joy.axes.assign(frame.axes, frame.axes + frame.num_axes);
+  joy.buttons.resize(frame.num_buttons);
+  for (int i = 0; i < frame.num_buttons; ++i)
+  {
+    joy.buttons[i] = (frame.buttons >> i) & 1u;
+  }
+  processJoy(socket_joy, clock->now());
+}
+
+double TeleopTwistJoy::Impl::blendWeight(const sensor_msgs::msg::Joy& joy_msg) const
+{
+  double weight = 0.0;
+  if (blend_weight_axis >= 0)
+  {
+    if (static_cast<int>(joy_msg.axes.size()) > blend_weight_axis)
+    {
+      // Affine map so that e.g. a trigger resting at +1.0 gives 0 and fully pressed at -1.0 gives 1.
+      weight = (joy_msg.axes[blend_weight_axis] - blend_weight_axis_rest) /
+               (blend_weight_axis_full - blend_weight_axis_rest);
+    }
+  }
+  else
+  {
+    // Largest deflection of any mapped axis: the harder the operator pushes, the more they own the robot.
+    const CompiledConfig& cfg = activeConfig();
+    for (int field = 0; field < NUM_FIELDS; ++field)
+    {
+      weight = std::max(weight, std::abs(axisValue(joy_msg, cfg.axis[field])));
+    }
+  }
+  return std::min(1.0, std::max(0.0, weight));
+}
+
+void TeleopTwistJoy::Impl::blendInto(geometry_msgs::msg::Twist& cmd_vel,
+                                     const rclcpp::Time& now) const
+{
+  // A joystick or planner that has gone quiet contributes nothing, and the other one then has
+  // the robot to itself rather than its share of it.
+  const bool joy_fresh = (now - last_joy_time).seconds() < blend_joy_timeout;
+  const bool planner_fresh =
+    stats.planner_msgs > 0 && (now - last_planner_time).seconds() < blend_planner_timeout;
+  const double j = joy_fresh ? (planner_fresh ? blend_weight : 1.0) : 0.0;
+  const double p = planner_fresh ? (joy_fresh ? 1.0 - blend_weight : 1.0) : 0.0;
+
+  cmd_vel.linear.x = j * joy_cmd_vel.linear.x + p * planner_cmd_vel.linear.x;
+  cmd_vel.linear.y = j * joy_cmd_vel.linear.y + p * planner_cmd_vel.linear.y;
+  cmd_vel.linear.z = j * joy_cmd_vel.linear.z + p * planner_cmd_vel.linear.z;
+  cmd_vel.angular.x = j * joy_cmd_vel.angular.x + p * planner_cmd_vel.angular.x;
+  cmd_vel.angular.y = j * joy_cmd_vel.angular.y + p * planner_cmd_vel.angular.y;
+  cmd_vel.angular.z = j * joy_cmd_vel.angular.z + p * planner_cmd_vel.angular.z;
+}
+
+void TeleopTwistJoy::Impl::plannerCallback(const geometry_msgs::msg::Twist::SharedPtr planner_msg)
+{
+  ++stats.wakeups;
+  planner_cmd_vel = *planner_msg;
+  last_planner_time = clock->now();
+  ++stats.planner_msgs;
+
+  // Playback and the joint output own the sticks, and cmd_vel with them, as on the Joy path.
+  if (macro_playing || arm_mode)
+  {
+    return;
+  }
+
+  // The joystick part is whatever the operator last commanded, including a command still held
+  // by the adaptive rate; publishCmdVel does the blend. A stop stays a stop for the Joy path.
+  publishCmdVel(pending_cmd_vel ? std::move(pending_cmd_vel) :
+                                  std::make_unique<geometry_msgs::msg::Twist>(joy_cmd_vel));
+}
+
+void TeleopTwistJoy::Impl::dropoutCallback()
+{
+  ++stats.wakeups;
+
+  const double gap = (clock->now() - last_joy_time).seconds();
+
+  // Playback owns cmd_vel, but a lost joystick can no longer release enable, so it ends playback.
+  if (macro_playing)
+  {
+    if (gap >= dropout_timeout)
+    {
+      abortPlayback();
+    }
+    return;
+  }
+
+  // Nothing to hold or decay once the robot has been told to stop.
+  if (sent_disable_msg)
+  {
+    return;
+  }
+
+  if (gap < dropout_timeout)
+  {
+    return;
+  }
+
+  if (!in_dropout)
+  {
+    in_dropout = true;
+    ++stats.dropout_activations;
+  }
+
+  const double elapsed = gap - dropout_timeout;
+  if (dropout_policy == "stop" || elapsed >= dropout_max_duration)
+  {
+    // Initializes with zeros by default.
+    publishCmdVel(std::make_unique<geometry_msgs::msg::Twist>());
+    sent_disable_msg = true;
+    ++stats.dropout_stops;
+    logEvent(EVENT_STOP, STOP_DROPOUT);
+    return;
+  }
+
+  double factor = 1.0;
+  if (dropout_policy == "decay")
+  {
+    if (dropout_decay_curve == "exponential")
+    {
+      // Reaches ~5% of the held command at dropout_max_duration, then the stop above takes over.
+      factor = std::exp(-3.0 * elapsed / dropout_max_duration);
+    }
+    else
+    {
+      factor = 1.0 - elapsed / dropout_max_duration;
+    }
+  }
+
+  // Through publishCmdVel like any other command, so blending, the rate statistics and the
+  // adaptive rate all see it.
+  auto cmd_vel_msg = std::make_unique<geometry_msgs::msg::Twist>(last_cmd_vel);
+  cmd_vel_msg->linear.x *= factor;
+  cmd_vel_msg->linear.y *= factor;
+  cmd_vel_msg->linear.z *= factor;
+  cmd_vel_msg->angular.x *= factor;
+  cmd_vel_msg->angular.y *= factor;
+  cmd_vel_msg->angular.z *= factor;
+  publishCmdVel(std::move(cmd_vel_msg));
+}
+
+void addStat(diagnostic_msgs::msg::DiagnosticStatus& status, const std::string& key, double value)
+{
+  diagnostic_msgs::msg::KeyValue kv;
+  kv.key = key;
+  kv.value = std::to_string(value);
+  status.values.push_back(kv);
+}
+
+double processCpuTime()
+{
+  // CPU time of the whole process, which includes any other components in the same container.
+  timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+  {
+    return 0.0;
+  }
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void TeleopTwistJoy::Impl::statsCallback()
+{
+  ++stats.wakeups;
+  const auto now = clock->now();
+  const double period = (now - stats.last_report).seconds();
+  const double cpu_time = processCpuTime();
+
+  auto status = std::make_unique<diagnostic_msgs::msg::DiagnosticStatus>();
+  status->name = "teleop_twist_joy";
+  status->level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status->message = in_dropout ? "dropout" : (idle ? "idle" : "ok");
+  addStat(*status, "joy_msgs", stats.joy_msgs);
+  addStat(*status, "cmd_vel_msgs", stats.cmd_vel_msgs);
+  addStat(*status, "dropout_activations", stats.dropout_activations);
+  addStat(*status, "dropout_stops", stats.dropout_stops);
+  addStat(*status, "dropout_last_duration", stats.dropout_last_duration);
+  addStat(*status, "dropout_max_duration", stats.dropout_max_duration);
+  addStat(*status, "dropout_total_duration", stats.dropout_total_duration);
+  addStat(*status, "cmd_vel_rate", stats.cmd_vel_rate);
+  if (adaptive_rate)
+  {
+    addStat(*status, "adaptive_target_rate", adaptive_target_rate);
+    addStat(*status, "adaptive_rate_skipped", stats.adaptive_rate_skipped);
+  }
+  for (size_t i = 0; i < stats.source_stale.size(); ++i)
+  {
+    addStat(*status, "joy_source_" + std::to_string(i) + "_stale", stats.source_stale[i]);
+  }
+  if (blend_mode)
+  {
+    addStat(*status, "planner_msgs", stats.planner_msgs);
+    addStat(*status, "blend_weight", blend_weight);
+  }
+  if (socket_input)
+  {
+    addStat(*status, "socket_frames", socket_input->received());
+    addStat(*status, "socket_invalid", socket_input->invalid());
+    addStat(*status, "socket_out_of_order", stats.socket_out_of_order);
+  }
+  if (link_feedback)
+  {
+    addStat(*status, "link_input_age", link_input_age);
+    addStat(*status, "link_loss", link_loss);
+    addStat(*status, "link_feedback_msgs", stats.link_feedback_msgs);
+  }
+  if (heading_hold)
+  {
+    addStat(*status, "heading_hold_corrections", stats.heading_hold_corrections);
+    addStat(*status, "heading_hold_stale_imu", stats.heading_hold_stale_imu);
+    addStat(*status, "heading_hold_error", heading_error);
+  }
+  if (publish_queue)
+  {
+    addStat(*status, "publish_queue_full", stats.publish_queue_full);
+    addStat(*status, "publish_queue_superseded", stats.publish_queue_superseded);
+  }
+  if (recorder)
+  {
+    addStat(*status, "recorder_dropped", recorder->dropped());
+  }
+  if (joy_batch_sub)
+  {
+    addStat(*status, "joy_batches", stats.joy_batches);
+    addStat(*status, "joy_batch_malformed", stats.joy_batch_malformed);
+  }
+  if (macro_record_button >= 0 || macro_play_button >= 0)
+  {
+    addStat(*status, "macro_commands", macro_recording ? 0 : macro.size());
+    addStat(*status, "macro_playbacks", stats.macro_playbacks);
+    addStat(*status, "macro_aborts", stats.macro_aborts);
+  }
+#ifndef NDEBUG
+  for (int64_t stage = 0; stage < activeConfig().num_stages && stage_timer.runs > 0; ++stage)
+  {
+    addStat(*status, "pipeline_stage_" + std::to_string(stage) + "_ns",
+      static_cast<double>(stage_timer.stage_ns[stage]) / stage_timer.runs);
+  }
+#endif
+  addStat(*status, "parameters_staged", stats.parameters_staged);
+  addStat(*status, "config_rebuilds", stats.config_rebuilds);
+  addStat(*status, "configs_shared_in_process", internedConfigs());
+  addStat(*status, "wakeups", stats.wakeups);
+  addStat(*status, "idle_entries", stats.idle_entries);
+  if (period > 0.0)
+  {
+    addStat(*status, "wakeups_per_second", (stats.wakeups - stats.last_wakeups) / period);
+    addStat(*status, "process_cpu_pct", 100.0 * (cpu_time - stats.last_cpu_time) / period);
+  }
+  addStat(*status, "process_cpu_time", cpu_time);
+  stats.last_wakeups = stats.wakeups;
+  stats.last_cpu_time = cpu_time;
+  stats.last_report = now;
+  stats_pub->publish(std::move(status));
+}
+
+bool TeleopTwistJoy::Impl::mappedAxesCentered(const sensor_msgs::msg::Joy& joy_msg, double deadband) const
+{
+  const CompiledConfig& cfg = activeConfig();
+  for (int field = 0; field < NUM_FIELDS; ++field)
+  {
+    if (std::abs(axisValue(joy_msg, cfg.axis[field])) > deadband ||
+        std::abs(axisValue(joy_msg, cfg.adjustment_axis[field])) > deadband)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TeleopTwistJoy::Impl::enterIdle()
+{
+  // The robot is already stopped, so the optional timers have nothing to do until the next edge.
+  idle = true;
+  ++stats.idle_entries;
+  for (auto timer : {dropout_timer, analytics_timer, adaptive_timer})
+  {
+    if (timer)
+    {
+      timer->cancel();
+    }
+  }
+  ROS_INFO_NAMED("TeleopTwistJoy", "Idle.");
+}
+
+void TeleopTwistJoy::Impl::leaveIdle()
+{
+  idle = false;
+  quiet = false;
+  for (auto timer : {dropout_timer, analytics_timer, adaptive_timer})
+  {
+    if (timer)
+    {
+      timer->reset();
+    }
+  }
+  ROS_INFO_NAMED("TeleopTwistJoy", "Leaving idle.");
+}
+
+bool TeleopTwistJoy::Impl::macroInput(const sensor_msgs::msg::Joy& joy_msg, bool enabled,
+                                      const rclcpp::Time& now)
+{
+  auto pressed = [&joy_msg](int64_t button)
+  {
+    return button >= 0 && static_cast<int64_t>(joy_msg.buttons.size()) > button && joy_msg.buttons[button];
+  };
+  const bool record = pressed(macro_record_button);
+  const bool play = pressed(macro_play_button);
+  const bool record_edge = record && !macro_record_pressed;
+  const bool play_edge = play && !macro_play_pressed;
+  macro_record_pressed = record;
+  macro_play_pressed = play;
+
+  if (macro_playing)
+  {
+    // The operator takes over the moment they touch a stick or let go of enable.
+    if (!enabled || !mappedAxesCentered(joy_msg, macro_abort_deadband))
+    {
+      abortPlayback();
+    }
+  }
+  else if (record_edge)
+  {
+    if (macro_recording)
+    {
+      finishRecording();
+    }
+    else
+    {
+      // An aborted playback thread may still be reading the old macro.
+      if (macro_thread.joinable())
+      {
+        macro_thread.join();
+      }
+      macro.clear();
+      macro_recording = true;
+      macro_record_start = now;
+      ROS_INFO_NAMED("TeleopTwistJoy", "Recording macro.");
+    }
+  }
+  else if (play_edge && enabled && !macro_recording && !macro.empty())
+  {
+    startPlayback();
+  }
+  return macro_playing;
+}
+
+void TeleopTwistJoy::Impl::finishRecording()
+{
+  macro_recording = false;
+  ROS_INFO_NAMED("TeleopTwistJoy", "Recorded macro of %zu commands.", macro.size());
+  if (!macro_file.empty() && !macro.save(macro_file))
+  {
+    RCLCPP_WARN(rclcpp::get_logger("TeleopTwistJoy"), "Could not save macro to %s.", macro_file.c_str());
+  }
+}
+
+void TeleopTwistJoy::Impl::startPlayback()
+{
+  // A previous playback has finished or been aborted, and its thread has been woken to exit.
+  if (macro_thread.joinable())
+  {
+    macro_thread.join();
+  }
+  // Drop a command the old thread handed over but the executor never took.
+  macro_slot.read();
+  macro_abort = false;
+  macro_playing = true;
+  ++stats.macro_playbacks;
+  logEvent(EVENT_MACRO_PLAYBACK, 0, static_cast<double>(macro.size()));
+  ROS_INFO_NAMED("TeleopTwistJoy", "Playing macro of %zu commands.", macro.size());
+  macro_thread = std::thread(&TeleopTwistJoy::Impl::playbackThread, this);
+}
+
+void TeleopTwistJoy::Impl::abortPlayback()
+{
+  {
+    std::lock_guard<std::mutex> lock(macro_mutex);
+    macro_abort = true;
+  }
+  macro_cv.notify_one();
+  // Commands only reach cmd_vel through macroCallback, which ignores them from here on, so
+  // nothing replayed can follow this stop. The thread is joined by the next playback or on shutdown.
+  macro_playing = false;
+  publishCmdVel(std::make_unique<geometry_msgs::msg::Twist>());
+  sent_disable_msg = true;
+  ++stats.macro_aborts;
+  logEvent(EVENT_STOP, STOP_MACRO_ABORT);
+  ROS_INFO_NAMED("TeleopTwistJoy", "Macro playback aborted.");
+}
+
+void TeleopTwistJoy::Impl::playbackThread()
+{
+  // Every change of the node clock wakes the wait below, so playback follows simulated time
+  // however fast it runs, and an abort wakes it at once even while simulated time is paused.
+  rcl_jump_threshold_t threshold;
+  threshold.on_clock_change = true;
+  threshold.min_forward.nanoseconds = 1;
+  threshold.min_backward.nanoseconds = -1;
+  auto jump_handler = clock->create_jump_callback(nullptr,
+    [this](const rcl_time_jump_t&)
+    {
+      std::lock_guard<std::mutex> lock(macro_mutex);
+      macro_cv.notify_one();
+    }, threshold);
+
+  const rclcpp::Time start = clock->now();
+  const std::chrono::nanoseconds slice(50000000);
+  for (size_t i = 0; i < macro.size(); ++i)
+  {
+    // Each command is scheduled against the start of playback rather than the previous one,
+    // so a late wakeup does not shift every command after it.
+    const rclcpp::Time target = start + rclcpp::Duration::from_nanoseconds(macro[i].offset_ns);
+    {
+      std::unique_lock<std::mutex> lock(macro_mutex);
+      for (rclcpp::Time wake = clock->now(); wake < target && !macro_abort; wake = clock->now())
+      {
+        macro_cv.wait_for(lock, std::min(slice, (target - wake).to_chrono<std::chrono::nanoseconds>()));
+      }
+      if (macro_abort)
+      {
+        return;
+      }
+    }
+
+    MacroCommand command;
+    Macro::toTwist(macro[i], command.cmd_vel);
+    macro_slot.write(command);
+    macro_waitable->trigger();
+  }
+
+  // Initializes with zeros by default.
+  MacroCommand stop;
+  stop.last = true;
+  macro_slot.write(stop);
+  macro_waitable->trigger();
+}
+
+void TeleopTwistJoy::Impl::macroCallback()
+{
+  ++stats.wakeups;
+  if (!macro_slot.fresh())
+  {
+    return;
+  }
+  // Only the latest command counts; one the executor was too late for is superseded anyway.
+  const MacroCommand& command = macro_slot.read();
+  if (!macro_playing)
+  {
+    // Aborted: the abort's stop stands.
+    return;
+  }
+  publishCmdVel(std::make_unique<geometry_msgs::msg::Twist>(command.cmd_vel));
+  if (command.last)
+  {
+    macro_playing = false;
+    sent_disable_msg = true;
+  }
+}
+
+void TeleopTwistJoy::Impl::updateAnalytics(const sensor_msgs::msg::Joy& joy_msg, int mode, double dt)
+{
+  // Gaps longer than a second are link or operator pauses, not time spent driving in a mode.
+  analytics.mode_time[analytics.mode] += std::min(dt, 1.0);
+  if (mode != analytics.mode)
+  {
+    ++analytics.mode_entries[mode];
+    if (analytics.mode != MODE_DISABLED && mode == MODE_DISABLED)
+    {
+      ++analytics.enable_releases;
+    }
+    analytics.mode = mode;
+  }
+
+  ++analytics.samples;
+  const size_t axes = joy_msg.axes.size() < Analytics::kMaxAxes ? joy_msg.axes.size() : Analytics::kMaxAxes;
+  analytics.axes = std::max(analytics.axes, axes);
+  for (size_t i = 0; i < axes; ++i)
+  {
+    const float value = joy_msg.axes[i];
+    const int bin = static_cast<int>((value + 1.0f) * (0.5f * Analytics::kBins));
+    ++analytics.histogram[i][std::min(std::max(bin, 0), static_cast<int>(Analytics::kBins) - 1)];
+    analytics.saturated[i] += std::abs(value) >= 0.99f;
+  }
+}
+
+std::unique_ptr<diagnostic_msgs::msg::DiagnosticStatus> TeleopTwistJoy::Impl::analyticsSnapshot() const
+{
+  static const char* mode_names[NUM_MODES] = {"disabled", "normal", "turbo", "autorun"};
+
+  auto status = std::make_unique<diagnostic_msgs::msg::DiagnosticStatus>();
+  status->name = "teleop_twist_joy_analytics";
+  status->level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status->message = mode_names[analytics.mode];
+  addStat(*status, "samples", analytics.samples);
+  for (int mode = 0; mode < NUM_MODES; ++mode)
+  {
+    addStat(*status, std::string("time_") + mode_names[mode], analytics.mode_time[mode]);
+    addStat(*status, std::string("entries_") + mode_names[mode], analytics.mode_entries[mode]);
+  }
+  addStat(*status, "autorun_toggles", analytics.autorun_toggles);
+  addStat(*status, "enable_releases", analytics.enable_releases);
+  for (size_t i = 0; i < analytics.axes; ++i)
+  {
+    const std::string prefix = "axis_" + std::to_string(i);
+    addStat(*status, prefix + "_saturation_pct",
+      analytics.samples > 0 ? 100.0 * analytics.saturated[i] / analytics.samples : 0.0);
+
+    diagnostic_msgs::msg::KeyValue kv;
+    kv.key = prefix + "_histogram";
+    for (size_t bin = 0; bin < Analytics::kBins; ++bin)
+    {
+      kv.value += (bin > 0 ? " " : "") + std::to_string(analytics.histogram[i][bin]);
+    }
+    status->values.push_back(kv);
+  }
+  return status;
+}
+
+void TeleopTwistJoy::Impl::analyticsCallback()
+{
+  ++stats.wakeups;
+  analytics_pub->publish(analyticsSnapshot());
+}
+
+void TeleopTwistJoy::Impl::logEvent(EventType type, uint32_t arg, double value)
+{
+  if (event_log)
+  {
+    event_log->log(clock->now().nanoseconds(), type, arg, value);
+  }
+}
+
+void TeleopTwistJoy::Impl::logRejection(const std::string& name, RejectReason reason)
+{
+  if (event_log)
+  {
+    event_log->logText(clock->now().nanoseconds(), EVENT_PARAMETER_REJECTED, reason, name);
+  }
+}
+
+void TeleopTwistJoy::Impl::joyCallback(const sensor_msgs::msg::Joy::SharedPtr joy_msg)
+{
+    ++stats.wakeups;
+    processJoy(joy_msg, clock->now());
+}
+
+void TeleopTwistJoy::Impl::joyBatchCallback(const std_msgs::msg::Float64MultiArray::SharedPtr batch)
+{
+    ++stats.wakeups;
+    const size_t columns = 1 + joy_batch_axes + joy_batch_buttons;
+    const size_t samples = batch->data.size() / columns;
+    if (samples == 0 || batch->data.size() % columns != 0)
+    {
+        ++stats.joy_batch_malformed;
+        return;
+    }
+    ++stats.joy_batches;
+
+    // The samples keep their spacing and end at the arrival of the batch, so everything timed
+    // against the node clock (dropout, idle, macros) sees them as if they had come one by one.
+    // A batch spanning more than the time since the previous input is squeezed up against it
+    // rather than reaching back before it, so no interval comes out negative.
+    const auto now = clock->now();
+    const double last_stamp = batch->data[(samples - 1) * columns];
+    double previous_offset = last_stamp - batch->data[0];
+    batch_holding = joy_batch_last_only;
+    for (size_t sample = 0; sample < samples; ++sample)
+    {
+        const double* row = &batch->data[sample * columns];
+        // Rows out of order are processed at the time of the row before them.
+        const double offset = std::max(0.0, std::min(previous_offset, last_stamp - row[0]));
+        previous_offset = offset;
+        const rclcpp::Time sample_time = std::max(last_joy_time, now - rclcpp::Duration::from_seconds(offset));
+
+        batch_joy->header.stamp = sample_time;
+        for (int64_t axis = 0; axis < joy_batch_axes; ++axis)
+        {
+            batch_joy->axes[axis] = static_cast<float>(row[1 + axis]);
+        }
+        for (int64_t button = 0; button < joy_batch_buttons; ++button)
+        {
+            batch_joy->buttons[button] = row[1 + joy_batch_axes + button] != 0.0;
+        }
+        processJoy(batch_joy, sample_time);
+    }
+
+    if (batch_holding)
+    {
+        batch_holding = false;
+        if (held_cmd_vel)
+        {
+            publishCmdVel(std::move(held_cmd_vel));
+        }
+        if (held_joint_msg)
+        {
+            joint_jog_pub->publish(std::move(held_joint_msg));
+        }
+    }
+}
+
+void TeleopTwistJoy::Impl::processJoy(const sensor_msgs::msg::Joy::SharedPtr raw_joy_msg, const rclcpp::Time& now)
+{
+    input_time = now;
+    if (recorder)
+    {
+        recorder->recordInput(now.nanoseconds(), raw_joy_msg->axes.data(), raw_joy_msg->axes.size(),
+          raw_joy_msg->buttons.data(), raw_joy_msg->buttons.size());
+    }
+    if (profile_db)
+    {
+        matchProfile(*raw_joy_msg);
+    }
+
+    // Everything below sees conditioned axes; the buffers of processed_joy are reused.
+    sensor_msgs::msg::Joy::SharedPtr joy_msg = raw_joy_msg;
+    if (activeConfig().axis_processing)
+    {
+        processed_joy->header = raw_joy_msg->header;
+        processed_joy->buttons = raw_joy_msg->buttons;
+        processAxes(activeConfig(), raw_joy_msg->axes, processed_joy->axes);
+        joy_msg = processed_joy;
+    }
+
+    if (link_feedback)
+    {
+        updateLinkFeedback(*joy_msg, now);
+    }
+
+    if (idle_timeout > 0.0)
+    {
+        // Any button change or stick movement is an edge; autorepeated idle input is not.
+        const bool edge = joy_msg->buttons != last_buttons || !mappedAxesCentered(*joy_msg, idle_deadband);
+        if (edge)
+        {
+            last_buttons = joy_msg->buttons;
+        }
+        if (idle)
+        {
+            if (!edge)
+            {
+                last_joy_time = now;
+                return;
+            }
+            leaveIdle();
+        }
+    }
+
+    const double joy_dt = (now - last_joy_time).seconds();
+    if (in_dropout)
+    {
+        const double duration = (now - last_joy_time).seconds();
+        stats.dropout_last_duration = duration;
+        stats.dropout_total_duration += duration;
+        stats.dropout_max_duration = std::max(stats.dropout_max_duration, duration);
+        in_dropout = false;
+    }
+    last_joy_time = now;
+    ++stats.joy_msgs;
+
+    const CompiledConfig& cfg = activeConfig();
+    const int64_t enable_autorun_button = cfg.enable_autorun_button;
+    const int64_t enable_turbo_button = cfg.enable_turbo_button;
+    const int64_t enable_button = cfg.enable_button;
+    const bool require_enable_button = cfg.require_enable_button;
+
+    if (joint_jog_pub)
+    {
+        const bool toggle = joint_jog_toggle_button >= 0 &&
+            static_cast<int>(joy_msg->buttons.size()) > joint_jog_toggle_button &&
+            joy_msg->buttons[joint_jog_toggle_button];
+        if (toggle && !joint_jog_toggle_pressed)
+        {
+            switchOutput(now);
+        }
+        joint_jog_toggle_pressed = toggle;
+    }
+
+    if(!arm_mode && enable_autorun_button >= 0 &&
+       static_cast<int>(joy_msg->buttons.size()) > enable_autorun_button)
+    {
+        auto autorun_button = joy_msg->buttons[enable_autorun_button];
+        if(autorun_button - this->autorun_buffer > 0)
+        {
+            this->autorun_flag = this->autorun_flag ? false : true;
+            ++analytics.autorun_toggles;
+            logEvent(EVENT_AUTORUN_TOGGLE, autorun_flag ? 1 : 0);
+        }
+        this->autorun_buffer = autorun_button;
+    }
+
+    bool macro_active = false;
+    if (!arm_mode && (macro_record_button >= 0 || macro_play_button >= 0))
+    {
+        const bool enabled = autorun_flag || !require_enable_button ||
+            (enable_button >= 0 && static_cast<int>(joy_msg->buttons.size()) > enable_button &&
+             joy_msg->buttons[enable_button]) ||
+            (enable_turbo_button >= 0 && static_cast<int>(joy_msg->buttons.size()) > enable_turbo_button &&
+             joy_msg->buttons[enable_turbo_button]);
+        macro_active = macroInput(*joy_msg, enabled, now);
+    }
+
+    if (blend_mode)
+    {
+        // Autorun and macro playback keep driving without stick input, so they take full control
+        // while engaged.
+        blend_weight = (autorun_flag || macro_active) ? 1.0 : blendWeight(*joy_msg);
+    }
+
+    if(!autorun_flag)
+    {
+        // 直進速度をリセット
+        this->speed_x_max = 0;
+    }
+
+    int mode = MODE_DISABLED;
+    if (macro_active)
+    {
+        // The playback thread publishes until it finishes or the operator takes over.
+        mode = MODE_NORMAL;
+    }
+    else if (arm_mode)
+    {
+        // Same enable and turbo logic as the base, applied to the joint tables.
+        if (enable_turbo_button >= 0 &&
+            static_cast<int>(joy_msg->buttons.size()) > enable_turbo_button &&
+            joy_msg->buttons[enable_turbo_button])
+        {
+            mode = MODE_TURBO;
+            sendJointJogMsg(*joy_msg, SCALE_TURBO);
+        }
+        else if (!require_enable_button ||
+                 (static_cast<int>(joy_msg->buttons.size()) > enable_button &&
+                  joy_msg->buttons[enable_button]))
+        {
+            mode = MODE_NORMAL;
+            sendJointJogMsg(*joy_msg, SCALE_NORMAL);
+        }
+        else if (!sent_joint_stop)
+        {
+            sendJointStop(now);
+        }
+    }
+    else if(autorun_flag)
+    {
+        mode = MODE_AUTORUN;
+        sendCmdVelMsg(joy_msg, SCALE_AUTORUN);
+    }
+    else if(enable_turbo_button >= 0 &&
+                static_cast<int>(joy_msg->buttons.size()) > enable_turbo_button &&
+                joy_msg->buttons[enable_turbo_button])
+    {
+        mode = MODE_TURBO;
+        sendCmdVelMsg(joy_msg, SCALE_TURBO);
+    }
+    else if (!require_enable_button ||
+            (static_cast<int>(joy_msg->buttons.size()) > enable_button &&
+             joy_msg->buttons[enable_button]))
+    {
+        mode = MODE_NORMAL;
+        sendCmdVelMsg(joy_msg, SCALE_NORMAL);
+    }
+    else
+    {
+        // When enable button is released, immediately send a single no-motion command
+        // in order to stop the robot. In blend mode this hands control back to the planner.
+        blend_weight = 0.0;
+        if (!sent_disable_msg)
+        {
+            // Initializes with zeros by default.
+            auto cmd_vel_msg = std::make_unique<geometry_msgs::msg::Twist>();
+            publishCmdVel(std::move(cmd_vel_msg));
+            sent_disable_msg = true;
+            logEvent(EVENT_STOP, STOP_ENABLE_RELEASED);
+        }
+    }
+
+    if (mode != last_mode)
+    {
+        logEvent(EVENT_MODE_CHANGE, mode, last_mode);
+        last_mode = mode;
+    }
+
+    if (analytics_enabled)
+    {
+        updateAnalytics(*joy_msg, mode, joy_dt);
+    }
+
+    if (idle_timeout > 0.0)
+    {
+        if (mode != MODE_DISABLED || !mappedAxesCentered(*joy_msg, idle_deadband))
+        {
+            quiet = false;
+        }
+        else if (!quiet)
+        {
+            quiet = true;
+            quiet_since = now;
+        }
+        else if ((now - quiet_since).seconds() >= idle_timeout)
+        {
+            enterIdle();
         }
     }
 }
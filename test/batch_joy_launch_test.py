@@ -0,0 +1,58 @@
+import time
+
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+
+import std_msgs.msg
+
+import test_joy_twist
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'axis_angular.yaw': 0,
+            'scale_linear.x': 1.0,
+            'scale_angular.yaw': 1.0,
+            'enable_button': 0,
+            'joy_batch.enabled': True,
+            'joy_batch.axes': 2,
+            'joy_batch.buttons': 1,
+            'joy_batch.output': 'last',
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class BatchJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        self.batch_pub = self.node.create_publisher(std_msgs.msg.Float64MultiArray, 'joy_batch', 1)
+        # Rows of [stamp, axes..., buttons...]. Only the last command of a batch is published.
+        self.batch = [
+            0.000, 0.1, 0.2, 1.0,
+            0.001, 0.2, 0.3, 1.0,
+            0.002, 0.3, 0.5, 1.0,
+        ]
+        self.expect_cmd_vel['linear']['x'] = 0.5
+        self.expect_cmd_vel['angular']['z'] = 0.3
+
+    def test_expected(self):
+        batch = std_msgs.msg.Float64MultiArray()
+        batch.data = self.batch
+        while self.received_cmd_vel is None:
+            self.batch_pub.publish(batch)
+            time.sleep(0.1)
+        super().test_expected()
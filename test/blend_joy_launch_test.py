@@ -0,0 +1,72 @@
+import time
+
+import geometry_msgs.msg
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+import sensor_msgs.msg
+
+import test_joy_twist
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'axis_angular.yaw': 0,
+            'scale_linear.x': 2.0,
+            'scale_angular.yaw': 3.0,
+            'enable_button': 0,
+            'blend_mode': True,
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class BlendJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        # Without planner input the joystick command goes out in full whatever the deflection.
+        self.joy_msg['axes'] = [0.3, 0.5]
+        self.joy_msg['buttons'] = [1]
+        self.expect_cmd_vel['linear']['x'] = 1.0
+        self.expect_cmd_vel['angular']['z'] = 0.9
+
+    def wait_for_cmd_vel(self, linear_x, angular_z, planner=None, timeout=5.0):
+        """Publish the joystick, and the planner when given, until cmd_vel matches."""
+        joy = sensor_msgs.msg.Joy()
+        joy.axes.extend(self.joy_msg['axes'])
+        joy.buttons.extend(self.joy_msg['buttons'])
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            self.pub.publish(joy)
+            if planner is not None:
+                self.planner_pub.publish(planner)
+            time.sleep(0.05)
+            cmd_vel = self.received_cmd_vel
+            if (cmd_vel is not None and abs(cmd_vel.linear.x - linear_x) < 1e-6 and
+                    abs(cmd_vel.angular.z - angular_z) < 1e-6):
+                return True
+        return False
+
+    def test_blended_with_planner(self):
+        self.planner_pub = self.node.create_publisher(geometry_msgs.msg.Twist, 'planner_cmd_vel', 10)
+        planner = geometry_msgs.msg.Twist()
+        planner.linear.x = 0.2
+        planner.angular.z = -0.4
+
+        # w is the largest deflection, 0.5: x 0.5 * 1.0 + 0.5 * 0.2, yaw 0.5 * 0.9 + 0.5 * -0.4.
+        self.assertTrue(self.wait_for_cmd_vel(0.6, 0.25, planner))
+
+        # Once the planner is older than blend_planner_timeout the joystick has full weight.
+        self.assertTrue(self.wait_for_cmd_vel(1.0, 0.9))
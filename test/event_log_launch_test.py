@@ -0,0 +1,83 @@
+import glob
+import os
+import subprocess
+import tempfile
+import time
+import unittest
+
+from ament_index_python.packages import get_package_prefix
+import launch
+import launch_ros.actions
+import launch_testing
+import launch_testing_ros
+import pytest
+import rclpy
+import sensor_msgs.msg
+
+LOG_PREFIX = os.path.join(tempfile.mkdtemp(), 'teleop')
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'enable_button': 0,
+            'event_log': LOG_PREFIX,
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class EventLogRoundTrip(unittest.TestCase):
+
+    def setUp(self):
+        self.context = rclpy.Context()
+        rclpy.init(context=self.context)
+        self.node = rclpy.create_node('test_event_log_node', context=self.context)
+        self.message_pump = launch_testing_ros.MessagePump(self.node, context=self.context)
+        self.pub = self.node.create_publisher(sensor_msgs.msg.Joy, 'joy', 1)
+        self.message_pump.start()
+
+    def tearDown(self):
+        self.message_pump.stop()
+        self.node.destroy_node()
+        rclpy.shutdown(context=self.context)
+
+    def publish_for(self, button, duration):
+        joy = sensor_msgs.msg.Joy()
+        joy.axes.extend([0.0, 0.5])
+        joy.buttons.append(button)
+        end = time.monotonic() + duration
+        while time.monotonic() < end:
+            self.pub.publish(joy)
+            time.sleep(0.05)
+
+    def test_decoded_events(self):
+        # Press and release the enable button, then give the log a few flush periods.
+        self.publish_for(1, 1.0)
+        self.publish_for(0, 0.5)
+        time.sleep(0.3)
+
+        segments = sorted(glob.glob(LOG_PREFIX + '.*.evlog'))
+        self.assertTrue(segments)
+        decoder = os.path.join(get_package_prefix('teleop_twist_joy'), 'lib', 'teleop_twist_joy',
+                               'event_log_decode')
+        output = subprocess.run([decoder] + segments, check=True, stdout=subprocess.PIPE,
+                                universal_newlines=True).stdout
+        events = [line.split(' ', 2)[2] for line in output.splitlines()]
+        self.assertEqual(events, [
+            'mode_change disabled -> normal',
+            'stop enable released',
+            'mode_change normal -> disabled',
+        ])
+
+        # Records are stamped in order and every line decodes with a stamp and thread index.
+        stamps = [float(line.split(' ', 1)[0]) for line in output.splitlines()]
+        self.assertEqual(stamps, sorted(stamps))
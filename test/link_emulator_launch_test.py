@@ -0,0 +1,101 @@
+import time
+import unittest
+
+import launch
+import launch_ros.actions
+import launch_testing
+import launch_testing_ros
+import pytest
+import rclpy
+import std_msgs.msg
+
+COUNT = 400
+PERIOD = 0.005
+DELAY = 0.05
+JITTER = 0.02
+LOSS = 0.2
+
+
+def emulator(name, **parameters):
+    parameters.update({'message_type': 'std_msgs/msg/Int64', 'seed': 7})
+    return launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='link_emulator_node',
+        name=name,
+        parameters=[parameters],
+        remappings=[('input', 'link_input'), ('output', name + '_output')],
+    )
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    # Two emulators with the same seed fed the same stream must lose the same messages.
+    link_a = emulator('link_a', delay=DELAY, jitter=JITTER, loss=LOSS)
+    link_b = emulator('link_b', delay=DELAY, jitter=JITTER, loss=LOSS)
+    invalid_link = emulator('invalid_link', loss=1.5)
+
+    return launch.LaunchDescription([
+            link_a,
+            link_b,
+            invalid_link,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class LinkEmulatorStatistics(unittest.TestCase):
+
+    def setUp(self):
+        self.context = rclpy.Context()
+        rclpy.init(context=self.context)
+        self.node = rclpy.create_node('test_link_emulator_node', context=self.context)
+        self.message_pump = launch_testing_ros.MessagePump(self.node, context=self.context)
+        self.pub = self.node.create_publisher(std_msgs.msg.Int64, 'link_input', 100)
+        self.received = {'link_a': {}, 'link_b': {}}
+        for name, arrivals in self.received.items():
+            self.node.create_subscription(
+                std_msgs.msg.Int64, name + '_output',
+                lambda msg, arrivals=arrivals: arrivals.setdefault(msg.data, time.monotonic()), 100)
+        self.message_pump.start()
+
+    def tearDown(self):
+        self.message_pump.stop()
+        self.node.destroy_node()
+        rclpy.shutdown(context=self.context)
+
+    def test_loss_and_delay(self):
+        end = time.monotonic() + 10.0
+        while (self.pub.get_subscription_count() < 2 or
+               any(self.node.count_publishers(name + '_output') < 1 for name in self.received)):
+            self.assertLess(time.monotonic(), end)
+            time.sleep(0.1)
+        time.sleep(0.5)
+
+        sent = {}
+        for seq in range(COUNT):
+            sent[seq] = time.monotonic()
+            self.pub.publish(std_msgs.msg.Int64(data=seq))
+            time.sleep(PERIOD)
+        time.sleep(DELAY + JITTER + 0.5)
+
+        a = self.received['link_a']
+        b = self.received['link_b']
+        self.assertEqual(sorted(a), sorted(b))
+
+        # 400 draws at 20% loss: 80 expected, with a standard deviation of 8.
+        delivered = len(a) / COUNT
+        self.assertGreater(delivered, 1.0 - LOSS - 0.1)
+        self.assertLess(delivered, 1.0 - LOSS + 0.1)
+
+        # Uniform jitter puts the mean at delay + jitter / 2, plus the local transport.
+        latencies = [a[seq] - sent[seq] for seq in a]
+        self.assertGreaterEqual(min(latencies), DELAY - 0.001)
+        mean = sum(latencies) / len(latencies)
+        self.assertGreater(mean, DELAY + JITTER / 2 - 0.005)
+        self.assertLess(mean, DELAY + JITTER / 2 + 0.02)
+
+
+@launch_testing.post_shutdown_test()
+class LinkEmulatorValidation(unittest.TestCase):
+
+    def test_invalid_parameter_rejected(self, proc_info, invalid_link):
+        self.assertNotEqual(proc_info[invalid_link].returncode, 0)
@@ -0,0 +1,59 @@
+import time
+
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+import rcl_interfaces.srv
+import rclpy.parameter
+
+import test_joy_twist
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'axis_angular.yaw': 0,
+            'scale_linear.x': 1.0,
+            'scale_angular.yaw': 1.0,
+            'enable_button': 0,
+            'pipeline': ['deadband:0.2', 'lowpass:0.1', 'expo:0.5:x', 'scale:2.0:yaw', 'limit:0.5:yaw'],
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class PipelineJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        # x: deadband (0.6 - 0.2) / 0.8 = 0.5, expo 0.5 * 0.5 + 0.5 * 0.5^3 = 0.3125.
+        # yaw: deadband (0.7 - 0.2) / 0.8 = 0.625, scale 1.25, limit 0.5.
+        # A steady input passes the low-pass filter unchanged from the first message.
+        self.joy_msg['axes'] = [0.7, 0.6]
+        self.joy_msg['buttons'] = [1]
+        self.expect_cmd_vel['linear']['x'] = 0.3125
+        self.expect_cmd_vel['angular']['z'] = 0.5
+
+    def test_non_finite_rejected(self):
+        client = self.node.create_client(rcl_interfaces.srv.SetParameters,
+                                         'teleop_twist_joy_node/set_parameters')
+        self.assertTrue(client.wait_for_service(timeout_sec=10.0))
+        # strtod reads "nan" and "inf", and NaN slips past every range comparison.
+        for stage in ['scale:nan', 'lowpass:inf', 'limit:-inf:yaw', 'deadband:nan']:
+            request = rcl_interfaces.srv.SetParameters.Request()
+            request.parameters = [
+                rclpy.parameter.Parameter('pipeline', value=[stage]).to_parameter_msg()]
+            future = client.call_async(request)
+            while not future.done():
+                time.sleep(0.05)
+            self.assertFalse(future.result().results[0].successful, stage)
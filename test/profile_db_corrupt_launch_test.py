@@ -0,0 +1,53 @@
+import struct
+
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+
+import profile_db_launch_test
+import test_joy_twist
+
+# Offset of CompiledConfig::num_stages within an entry: everything up to the joint tables.
+NUM_STAGES_OFFSET = struct.calcsize('<6q6q18d?7x4q16q48d')
+
+
+def build_corrupt_database():
+    """The database of profile_db_launch_test with its only entry claiming 1000 pipeline stages."""
+    database = profile_db_launch_test.build_database()
+    with open(database, 'r+b') as f:
+        entries_offset = struct.unpack_from('<4s5I2Q', f.read(64))[7]
+        f.seek(entries_offset + NUM_STAGES_OFFSET)
+        f.write(struct.pack('<q', 1000))
+    return database
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'axis_angular.yaw': 2,
+            'enable_button': 0,
+            'profile_database': build_corrupt_database(),
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class ProfileDbCorruptJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        # The database is rejected as a whole, so the parameters apply: both default scales 0.5.
+        self.joy_msg['axes'] = [0.2, 0.4, 0.6]
+        self.joy_msg['buttons'] = [1]
+        self.expect_cmd_vel['linear']['x'] = 0.2
+        self.expect_cmd_vel['angular']['z'] = 0.3
@@ -0,0 +1,73 @@
+import os
+import subprocess
+import sys
+import tempfile
+
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+
+import test_joy_twist
+
+GENERATOR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'scripts',
+                         'generate_fixed_profile.py')
+
+# Touches members from the start to the end of CompiledConfig, so the node only reproduces the
+# expected command if the generator's packing matches the struct layout member for member.
+PROFILE = '''
+teleop_twist_joy_node:
+  ros__parameters:
+    axis_linear:
+      x: 1
+    scale_linear:
+      x: 2.0
+    axis_angular:
+      yaw: 2
+    scale_angular:
+      yaw: 3.0
+    enable_button: 0
+    pipeline: ['scale:0.5:x']
+    axis_normalization:
+      gain: [1.0, 1.0, -0.5]
+'''
+
+
+def build_database():
+    directory = tempfile.mkdtemp()
+    with open(os.path.join(directory, 'test.config.yaml'), 'w') as f:
+        f.write(PROFILE)
+    with open(os.path.join(directory, 'profiles.yaml'), 'w') as f:
+        f.write('- config: test.config.yaml\n  axes: 3\n  buttons: 1\n')
+    database = os.path.join(directory, 'profiles.db')
+    subprocess.run([sys.executable, GENERATOR, '--database', os.path.join(directory, 'profiles.yaml'),
+                    database], check=True)
+    return database
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'profile_database': build_database(),
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class ProfileDbJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        # x: 0.4 * pipeline 0.5 * scale 2.0; yaw: 0.6 * gain -0.5 * scale 3.0.
+        self.joy_msg['axes'] = [0.2, 0.4, 0.6]
+        self.joy_msg['buttons'] = [1]
+        self.expect_cmd_vel['linear']['x'] = 0.4
+        self.expect_cmd_vel['angular']['z'] = -0.9
@@ -0,0 +1,133 @@
+import time
+import unittest
+
+import geometry_msgs.msg
+import launch
+import launch_ros.actions
+import launch_testing
+import launch_testing_ros
+import pytest
+import rclpy
+import rosgraph_msgs.msg
+import sensor_msgs.msg
+
+CLOCK_STEP = 0.01
+JOY_PERIOD = 0.05
+DRIVE_TIME = 0.5
+COAST_TIME = 1.5
+DROPOUT_TIMEOUT = 0.1
+DROPOUT_MAX_DURATION = 0.8
+DROPOUT_CHECK_PERIOD = 0.05
+# Steps by which receipt, stamped with the test's clock, may trail the node at each speed-up.
+RECEIPT_LAG_STEPS = {10.0: 3, 100.0: 10}
+
+
+def linear_decay(gap):
+    return min(1.0, max(0.0, 1.0 - (gap - DROPOUT_TIMEOUT) / DROPOUT_MAX_DURATION))
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'use_sim_time': True,
+            'axis_linear.x': 1,
+            'scale_linear.x': 1.0,
+            'enable_button': 0,
+            'dropout_policy': 'decay',
+            'dropout_timeout': DROPOUT_TIMEOUT,
+            'dropout_max_duration': DROPOUT_MAX_DURATION,
+            'dropout_check_period': DROPOUT_CHECK_PERIOD,
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class SimTimeDropout(unittest.TestCase):
+    """Runs a drive-then-dropout scenario on simulated time at several speed-ups."""
+
+    def setUp(self):
+        self.context = rclpy.Context()
+        rclpy.init(context=self.context)
+        self.node = rclpy.create_node('test_sim_time_dropout_node', context=self.context)
+        self.message_pump = launch_testing_ros.MessagePump(self.node, context=self.context)
+        self.clock_pub = self.node.create_publisher(rosgraph_msgs.msg.Clock, '/clock', 10)
+        self.joy_pub = self.node.create_publisher(sensor_msgs.msg.Joy, 'joy', 10)
+        self.sub = self.node.create_subscription(geometry_msgs.msg.Twist,
+                                                 'cmd_vel', self.callback, 100)
+        self.message_pump.start()
+        self.sim_time = 1.0
+        self.received = []
+
+    def tearDown(self):
+        self.message_pump.stop()
+        self.node.destroy_node()
+        rclpy.shutdown(context=self.context)
+
+    def callback(self, msg):
+        self.received.append((self.sim_time, msg.linear.x))
+
+    def step(self, speedup):
+        self.sim_time += CLOCK_STEP
+        clock = rosgraph_msgs.msg.Clock()
+        clock.clock.sec = int(self.sim_time)
+        clock.clock.nanosec = int(round((self.sim_time - int(self.sim_time)) * 1e9))
+        self.clock_pub.publish(clock)
+        time.sleep(CLOCK_STEP / speedup)
+
+    def run_scenario(self, speedup):
+        joy = sensor_msgs.msg.Joy()
+        joy.axes.extend([0.0, 1.0])
+        joy.buttons.extend([1])
+
+        self.received = []
+        start = self.sim_time
+        next_joy = start
+        while self.sim_time < start + DRIVE_TIME:
+            if self.sim_time >= next_joy:
+                self.joy_pub.publish(joy)
+                next_joy += JOY_PERIOD
+            self.step(speedup)
+        last_joy = next_joy - JOY_PERIOD
+        while self.sim_time < start + DRIVE_TIME + COAST_TIME:
+            self.step(speedup)
+        return [(stamp - last_joy, value) for stamp, value in self.received if stamp > last_joy]
+
+    def check_decay(self, coast, speedup):
+        values = [value for _, value in coast]
+        self.assertTrue(values, 'no commands after the last Joy message')
+        self.assertAlmostEqual(values[-1], 0.0)
+        self.assertTrue(any(0.05 < value < 0.95 for value in values), values)
+        for earlier, later in zip(values, values[1:]):
+            self.assertLessEqual(later, earlier + 1e-6)
+        # The node computed each value at most lag before its receipt was stamped, and the curve
+        # only falls, so the value lies between the curve at the receipt and lag before it. The
+        # node may also have taken in the last Joy message a step or two behind the test.
+        lag = RECEIPT_LAG_STEPS[speedup] * CLOCK_STEP
+        for gap, value in coast:
+            if gap < DROPOUT_TIMEOUT:
+                continue
+            self.assertGreaterEqual(value, linear_decay(gap + 2 * CLOCK_STEP) - 1e-6, (gap, value))
+            self.assertLessEqual(value, linear_decay(gap - lag) + 1e-6, (gap, value))
+
+        # Nothing stops before the timeout and the longest dropout have passed, and the stop goes
+        # out at the first dropout check after that.
+        stop = next(gap for gap, value in coast if value == 0.0)
+        self.assertGreaterEqual(stop, DROPOUT_TIMEOUT + DROPOUT_MAX_DURATION - CLOCK_STEP)
+        self.assertLessEqual(stop, DROPOUT_TIMEOUT + DROPOUT_MAX_DURATION + DROPOUT_CHECK_PERIOD + lag)
+
+    def test_time_scaled(self):
+        # Let the node pick up simulated time before driving.
+        for _ in range(20):
+            self.step(10.0)
+
+        # The decay depends on simulated time only, so both speed-ups follow the same curve and stop
+        # at the same simulated time.
+        for speedup in (10.0, 100.0):
+            self.check_decay(self.run_scenario(speedup), speedup)
@@ -0,0 +1,42 @@
+import launch
+import launch_ros.actions
+import launch_testing
+
+import pytest
+
+import test_joy_twist
+
+
+@pytest.mark.rostest
+def generate_test_description():
+    teleop_node = launch_ros.actions.Node(
+        package='teleop_twist_joy',
+        executable='teleop_node',
+        parameters=[{
+            'axis_linear.x': 1,
+            'axis_angular.yaw': 0,
+            'scale_linear.x': 1.0,
+            'scale_angular.yaw': 1.0,
+            'enable_button': 2,
+            'stick_pairs': [0, 1],
+            'stick_radial_deadzone': 0.2,
+            'stick_circle_to_square': True,
+        }],
+    )
+
+    return launch.LaunchDescription([
+            teleop_node,
+            launch_testing.actions.ReadyToTest(),
+        ]), locals()
+
+
+class StickJoy(test_joy_twist.TestJoyTwist):
+
+    def setUp(self):
+        super().setUp()
+        # Radius 0.5 with a 0.2 deadzone rescales to (0.5 - 0.2) / 0.8 = 0.375, then stretching
+        # the circle to the square scales by 0.5 / 0.4: (0.3, 0.4) becomes (0.28125, 0.375).
+        self.joy_msg['axes'] = [0.3, 0.4]
+        self.joy_msg['buttons'] = [0, 0, 1]
+        self.expect_cmd_vel['linear']['x'] = 0.375
+        self.expect_cmd_vel['angular']['z'] = 0.28125